@@ -0,0 +1,144 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QPageSize>
+#include <QPdfWriter>
+#include <QSvgGenerator>
+
+#include "chart_export.hpp"
+#include "ganttry_graphics.hpp"
+
+namespace ganttry
+{
+
+bool export_chart(Project & project, const QString & filename, QString & error, int page_height)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    if (suffix != "svg" && suffix != "pdf" && suffix != "png")
+    {
+        error = "Unknown chart format \"" + suffix + "\", use svg, pdf or png";
+        return false;
+    }
+
+    // same layout as on screen
+    DatesGraphicsScene dates(project);
+    NamesGraphicsScene names(project, dates);
+    GanttGraphicsScene gantt(project, names, dates);
+    dates.redraw();
+    names.redraw();
+    gantt.redraw();
+    std::shared_ptr<const GanttLayout> layout = gantt.get_layout();
+    if ( ! layout || names.rows_info().empty())
+    {
+        error = "Nothing to export in " + QString::fromStdString(project.name);
+        return false;
+    }
+
+    int names_width  = std::ceil(names.width());
+    int chart_width  = layout->width;
+    int header       = std::ceil(dates.height());
+    int width        = names_width + chart_width;
+
+    // bands end between rows
+    std::vector<int> bands{0};
+    int rows_height = 0;
+    for (const row_info & info : names.rows_info())
+    {
+        if (rows_height + info.height - bands.back() > page_height && rows_height > bands.back())
+            bands.push_back(rows_height);
+        rows_height += info.height;
+    }
+    bands.push_back(rows_height);
+    int band_height = 0;
+    for (size_t i=1 ; i<bands.size() ; i++)
+        band_height = std::max(band_height, bands[i] - bands[i-1]);
+
+    auto paint_header = [&](QPainter & painter, qreal y)
+        {
+            dates.render(&painter, QRectF(names_width, y, chart_width, header), QRectF(0, 0, chart_width, header), Qt::IgnoreAspectRatio);
+        };
+    // rows [top,bottom) of the scenes at y
+    auto paint_rows = [&](QPainter & painter, int top, int bottom, qreal y)
+        {
+            QRectF source(0, top, chart_width, bottom - top);
+            names.render(&painter, QRectF(0, y, names_width, bottom - top), QRectF(0, top, names_width, bottom - top), Qt::IgnoreAspectRatio);
+            painter.save();
+            painter.translate(names_width, y - top);
+            painter.setClipRect(source);
+            paint_gantt(painter, *layout, source);
+            painter.restore();
+        };
+
+    if (suffix == "svg")
+    {
+        // one document, still drawn band by band
+        QSvgGenerator svg;
+        svg.setFileName(filename);
+        svg.setSize(QSize(width, header + rows_height));
+        svg.setViewBox(QRect(0, 0, width, header + rows_height));
+        svg.setTitle(QString::fromStdString(project.name));
+        QPainter painter;
+        if ( ! painter.begin(&svg))
+        {
+            error = "Could not write " + filename;
+            return false;
+        }
+        painter.fillRect(QRect(0, 0, width, header + rows_height), Qt::white);
+        paint_header(painter, 0);
+        for (size_t i=1 ; i<bands.size() ; i++)
+            paint_rows(painter, bands[i-1], bands[i], header + bands[i-1]);
+        return painter.end();
+    }
+
+    if (suffix == "pdf")
+    {
+        // a pixel per point, pages as large as the largest band
+        QPdfWriter pdf(filename);
+        pdf.setTitle(QString::fromStdString(project.name));
+        pdf.setResolution(72);
+        pdf.setPageSize(QPageSize(QSizeF(width, header + band_height), QPageSize::Point, QString(), QPageSize::ExactMatch));
+        pdf.setPageMargins(QMarginsF(0, 0, 0, 0));
+        QPainter painter;
+        if ( ! painter.begin(&pdf))
+        {
+            error = "Could not write " + filename;
+            return false;
+        }
+        for (size_t i=1 ; i<bands.size() ; i++)
+        {
+            if (i > 1)
+                pdf.newPage();
+            paint_header(painter, 0);
+            paint_rows(painter, bands[i-1], bands[i], header);
+        }
+        return painter.end();
+    }
+
+    // png, a file per band once there is more than one
+    QFileInfo info(filename);
+    for (size_t i=1 ; i<bands.size() ; i++)
+    {
+        QString page_filename = bands.size() == 2
+                              ? filename
+                              : info.path() + "/" + info.completeBaseName() + QString("_%1.").arg(i, 3, 10, QChar('0')) + info.suffix();
+        QImage image(width, header + bands[i] - bands[i-1], QImage::Format_RGB32);
+        image.fill(Qt::white);
+        {
+            QPainter painter(&image);
+            paint_header(painter, 0);
+            paint_rows(painter, bands[i-1], bands[i], header);
+        }
+        if ( ! image.save(page_filename))
+        {
+            error = "Could not write " + page_filename;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QString>
+
+#include "project.hpp"
+
+namespace ganttry
+{
+
+// Draws the project's whole chart, names on the left and dates on top,
+// with the same scenes as the window but without any view. The format
+// follows the file's suffix: svg, pdf or png. Rows go out in bands of
+// about page_height pixels; a pdf gets one page per band and a png one
+// numbered file per band (chart_001.png, ...), each with the dates
+// repeated, so no more than one band is ever rasterized.
+bool export_chart(Project & project, const QString & filename, QString & error, int page_height = 2000);
+
+} // namespace
@@ -0,0 +1,144 @@
+
+#include "costs.hpp"
+#include "workspace.hpp"
+
+namespace ganttry
+{
+
+CostRollup::ProjectEntry & CostRollup::get_entry(const Project & project)
+{
+    auto [it,b] = projects.insert({&project, {}});
+    ProjectEntry & entry = it->second;
+    if ( ! b)
+        return entry;
+
+    for (const auto & p : project.tasks)
+    {
+        const Task_Base & task = *p.second;
+        if (task.is_recursive())
+            embedded_in[task.get_child()].insert(&project);
+        else if (task.is_relative())
+        {
+            Cost cost = compute_task_cost(task);
+            entry.tasks[p.first] = cost;
+            entry.own += cost;
+        }
+    }
+    return entry;
+}
+
+Cost CostRollup::compute_task_cost(const Task_Base & task)
+{
+    if (task.is_recursive())
+        return project_total_cost(*task.get_child());
+    if ( ! task.is_relative() || task.get_template_id() < 0)
+        return {};
+
+    const TaskTemplate * templ_ptr = workspace->find_task_template(task.get_template_id());
+    if ( ! templ_ptr)
+        return {};
+    const TaskTemplate & templ = *templ_ptr;
+    return { (double)task.get_unit_count_forecast() * templ.effective_material_cost_per_unit()
+           , (double)task.get_unit_count_forecast() * templ.effective_manpower_cost_per_unit()
+           };
+}
+
+void CostRollup::invalidate_totals(const Project & project)
+{
+    auto it = projects.find(&project);
+    if (it != projects.end())
+    {
+        // an invalid total means the ones above are invalid already
+        if ( ! it->second.total_valid)
+            return;
+        it->second.total_valid = false;
+    }
+
+    auto it_parents = embedded_in.find(&project);
+    if (it_parents != embedded_in.end())
+        for (const Project * parent : it_parents->second)
+            invalidate_totals(*parent);
+}
+
+Cost CostRollup::task_cost(const Task_Base & task)
+{
+    if (task.is_recursive())
+        return project_total_cost(*task.get_child());
+
+    ProjectEntry & entry = get_entry(task.get_project());
+    auto it = entry.tasks.find(task.get_id());
+    if (it == entry.tasks.end())
+        return {};
+    return it->second;
+}
+
+Cost CostRollup::project_own_cost(const Project & project)
+{
+    return get_entry(project).own;
+}
+
+Cost CostRollup::project_total_cost(const Project & project)
+{
+    ProjectEntry & entry = get_entry(project);
+    if (entry.total_valid)
+        return entry.total;
+
+    Cost total = entry.own;
+    for (const auto & p : project.tasks)
+        if (p.second->is_recursive())
+            total += project_total_cost(*p.second->get_child());
+
+    entry.total = total;
+    entry.total_valid = true;
+    return total;
+}
+
+void CostRollup::task_changed(const Task_Base & task)
+{
+    if (task.is_recursive() || ! task.is_relative())
+        return;
+
+    const Project & project = task.get_project();
+    auto it_entry = projects.find(&project);
+    if (it_entry == projects.end())
+        return; // computed from scratch on next use
+
+    ProjectEntry & entry = it_entry->second;
+    Cost cost = compute_task_cost(task);
+    Cost & task_entry = entry.tasks[task.get_id()];
+    entry.own -= task_entry;
+    entry.own += cost;
+    task_entry = cost;
+
+    invalidate_totals(project);
+}
+
+void CostRollup::template_changed(TemplateID id)
+{
+    const auto * tasks = workspace->find_template_tasks(id);
+    if (tasks == nullptr)
+        return;
+    for (const Task_Templated * task : *tasks)
+    {
+        auto it_entry = projects.find(&task->get_project());
+        if (it_entry == projects.end())
+            continue; // computed from scratch on next use
+        ProjectEntry & entry = it_entry->second;
+        auto it = entry.tasks.find(task->get_id());
+        if (it == entry.tasks.end())
+            continue;
+        Cost cost = compute_task_cost(*task);
+        entry.own -= it->second;
+        entry.own += cost;
+        it->second = cost;
+        invalidate_totals(*it_entry->first);
+    }
+}
+
+void CostRollup::project_changed(const Project & project)
+{
+    invalidate_totals(project);
+    projects.erase(&project);
+}
+
+} // namespace
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <set>
+
+#include "types.hpp"
+#include "project.hpp"
+
+namespace ganttry
+{
+
+class Workspace;
+
+struct Cost
+{
+    double material = 0;
+    double manpower = 0;
+
+    inline double total() const { return material + manpower; }
+    inline Cost & operator+=(const Cost & other) { material += other.material; manpower += other.manpower; return *this; }
+    inline Cost & operator-=(const Cost & other) { material -= other.material; manpower -= other.manpower; return *this; }
+};
+
+// Material and manpower costs per task, per project and through subprojects.
+// Task costs and per project subtotals are cached; a task edit only moves
+// its project's subtotal by the difference and marks the recursive totals
+// of the projects embedding it as stale.
+class CostRollup
+{
+    struct ProjectEntry
+    {
+        std::map<TaskID,Cost> tasks;
+        Cost own;               // templated tasks only
+        Cost total;             // own + subprojects, recursively
+        bool total_valid = false;
+    };
+
+    Workspace * workspace;
+    std::map<const Project*,ProjectEntry> projects;
+    std::map<const Project*,std::set<const Project*>> embedded_in;
+
+    ProjectEntry & get_entry(const Project & project);
+    Cost compute_task_cost(const Task_Base & task);
+    void invalidate_totals(const Project & project);
+
+public:
+    inline CostRollup(Workspace & w)
+        : workspace(&w)
+    {}
+
+    inline void set_workspace(Workspace * w) { workspace = w; clear(); }
+    inline void clear() { projects.clear(); embedded_in.clear(); }
+
+    Cost task_cost(const Task_Base & task);
+    Cost project_own_cost(const Project & project);
+    Cost project_total_cost(const Project & project);
+
+    // incremental updates
+    void task_changed(const Task_Base & task);
+    void template_changed(TemplateID id);
+    void project_changed(const Project & project); // tasks added or removed
+};
+
+} // namespace
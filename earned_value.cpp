@@ -0,0 +1,169 @@
+
+#include <algorithm>
+#include <functional>
+
+#include "earned_value.hpp"
+#include "workspace.hpp"
+
+namespace ganttry
+{
+
+EarnedValueSeries compute_earned_value(const Project & project, nixtime status_date)
+{
+    struct Event
+    {
+        nixtime time;
+        double planned_rate; // per second, changes
+        double  earned_rate;
+        double  actual_rate;
+        double planned_lump;
+        double  earned_lump;
+        double  actual_lump;
+    };
+
+    EarnedValueSeries result;
+    result.project = &project;
+    result.status_date = status_date;
+
+    std::vector<Event> events;
+    events.push_back({status_date, 0, 0, 0, 0, 0, 0}); // always have a point there
+
+    // spreads value over [begin,end), or drops it at begin when empty
+    auto spread = [&](nixtime begin, nixtime end, double value, double Event::*rate, double Event::*lump)
+        {
+            if (value == 0)
+                return;
+            if (end <= begin)
+            {
+                Event e{begin, 0, 0, 0, 0, 0, 0};
+                e.*lump = value;
+                events.push_back(e);
+                return;
+            }
+            Event e_begin{begin, 0, 0, 0, 0, 0, 0};
+            Event e_end  {end  , 0, 0, 0, 0, 0, 0};
+            e_begin.*rate =  value / (end - begin);
+            e_end  .*rate = -value / (end - begin);
+            events.push_back(e_begin);
+            events.push_back(e_end);
+        };
+
+    std::function<void(const Project &, nixtime)> collect = [&](const Project & proj, nixtime base_start_time)
+        {
+            for (const auto & p : proj.tasks)
+            {
+                const Task_Base & task = *p.second;
+                nixtime start = base_start_time + task.get_unixtime_start_offset();
+                if (task.is_recursive())
+                {
+                    collect(*task.get_child(), start);
+                    continue;
+                }
+                if ( ! task.is_relative() || task.get_unit_count_forecast() <= 0)
+                    continue;
+                const TaskTemplate * templ_ptr = project.workspace.find_task_template(task.get_template_id());
+                if ( ! templ_ptr)
+                    continue;
+                const TaskTemplate & templ = *templ_ptr;
+
+                float forecast = task.get_unit_count_forecast();
+                float done     = std::min(task.get_units_done_count(), forecast);
+                double budget = forecast * ((double)templ.default_material_cost_per_unit + templ.default_manpower_cost_per_unit);
+                double earned = budget * done / forecast;
+                double actual = (double)task.get_actual_material_cost() + task.get_actual_manpower_cost();
+                if (actual == 0)
+                    actual = done * ((double)templ.effective_material_cost_per_unit() + templ.effective_manpower_cost_per_unit());
+
+                // the scheduled bar only covers the remaining work, so plan
+                // over the full scope instead: all units at the template's
+                // UDM, from the task's start
+                float UDM = project.workspace.get_task_template_UDM(task.get_template_id());
+                nixtime end = start + (nixtime_diff)(86400 * (UDM != 0 ? forecast / UDM : 1));
+                result.budget_at_completion += budget;
+                spread(start, end, budget, &Event::planned_rate, &Event::planned_lump);
+
+                // work done so far, up to the status date
+                nixtime progress_begin = std::min(start, status_date);
+                nixtime progress_end   = std::max(progress_begin, std::min(end, status_date));
+                spread(progress_begin, progress_end, earned, &Event::earned_rate, &Event::earned_lump);
+                spread(progress_begin, progress_end, actual, &Event::actual_rate, &Event::actual_lump);
+            }
+        };
+    collect(project, project.get_unixtime_start());
+
+    std::sort(events.begin(), events.end(), [](const Event & left, const Event & right) { return left.time < right.time; });
+
+    double planned = 0, earned = 0, actual = 0;
+    double planned_rate = 0, earned_rate = 0, actual_rate = 0;
+    result.points.reserve(events.size());
+    for (size_t i=0 ; i<events.size() ; )
+    {
+        nixtime time = events[i].time;
+        if ( ! result.points.empty())
+        {
+            double seconds = time - result.points.back().time;
+            planned += planned_rate * seconds;
+            earned  +=  earned_rate * seconds;
+            actual  +=  actual_rate * seconds;
+        }
+        for ( ; i<events.size() && events[i].time == time ; i++)
+        {
+            planned_rate += events[i].planned_rate;
+             earned_rate += events[i]. earned_rate;
+             actual_rate += events[i]. actual_rate;
+            planned      += events[i].planned_lump;
+            earned       += events[i]. earned_lump;
+            actual       += events[i]. actual_lump;
+        }
+        result.points.push_back({time, planned, earned, actual});
+        if (time == status_date)
+        {
+            result.planned_value = planned;
+            result.earned_value  = earned;
+            result.actual_cost   = actual;
+        }
+    }
+
+    result.SPI = result.planned_value == 0 ? 0 : result.earned_value / result.planned_value;
+    result.CPI = result.actual_cost   == 0 ? 0 : result.earned_value / result.actual_cost;
+    return result;
+}
+
+std::vector<EarnedValueSeries> compute_earned_value(const Workspace & workspace, nixtime status_date)
+{
+    std::vector<EarnedValueSeries> result;
+    result.reserve(workspace.get_projects().size());
+    for (const auto & project : workspace.get_projects())
+        result.push_back(compute_earned_value(*project, status_date));
+    return result;
+}
+
+// quoted, with embedded quotes doubled
+static std::string csv_field(const std::string & s)
+{
+    std::string result = "\"";
+    for (char c : s)
+    {
+        if (c == '"')
+            result += '"';
+        result += c;
+    }
+    return result + "\"";
+}
+
+void write_csv(std::ostream & out, const EarnedValueSeries & series)
+{
+    out << "time,planned_value,earned_value,actual_cost" << std::endl;
+    for (const EarnedValuePoint & point : series.points)
+        out << point.time << "," << point.planned_value << "," << point.earned_value << "," << point.actual_cost << std::endl;
+}
+
+void write_csv(std::ostream & out, const std::vector<EarnedValueSeries> & portfolio)
+{
+    out << "project,time,planned_value,earned_value,actual_cost" << std::endl;
+    for (const EarnedValueSeries & series : portfolio)
+        for (const EarnedValuePoint & point : series.points)
+            out << csv_field(series.project->name) << "," << point.time << "," << point.planned_value << "," << point.earned_value << "," << point.actual_cost << std::endl;
+}
+
+} // namespace
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "types.hpp"
+#include "project.hpp"
+
+namespace ganttry
+{
+
+class Workspace;
+
+struct EarnedValuePoint
+{
+    nixtime time;
+    double  planned_value;
+    double  earned_value;
+    double  actual_cost;
+};
+
+// Points are only emitted where a task starts or ends, plus the status
+// date; values between two points are linear.
+struct EarnedValueSeries
+{
+    const Project * project = nullptr;
+    nixtime status_date = 0;
+    std::vector<EarnedValuePoint> points;
+
+    // at the status date, the indices are 0 when undefined
+    double budget_at_completion = 0;
+    double planned_value        = 0;
+    double earned_value         = 0;
+    double actual_cost          = 0;
+    double SPI                  = 0;
+    double CPI                  = 0;
+};
+
+// Budgets come from the templates' default costs per unit. Planned value
+// is spread evenly over each task's full-scope bar, the forecast units at
+// the template's UDM from the task's start, since the scheduled bar only
+// holds the remaining work; earned value and actual cost accrue over the
+// same bar until the status date. Actual cost is the
+// recorded one, or done units at the template's effective cost when
+// nothing was recorded.
+EarnedValueSeries compute_earned_value(const Project & project, nixtime status_date);
+std::vector<EarnedValueSeries> compute_earned_value(const Workspace & workspace, nixtime status_date);
+
+void write_csv(std::ostream & out, const EarnedValueSeries & series);
+void write_csv(std::ostream & out, const std::vector<EarnedValueSeries> & portfolio);
+
+} // namespace
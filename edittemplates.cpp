@@ -18,11 +18,11 @@ EditTemplates::EditTemplates(ganttry::Workspace & w, QWidget *parent) :
 
     for (const auto & task_template : workspace.get_task_templates())
     {
-        QListWidgetItem * item = new QListWidgetItem(QString::fromStdString(task_template.second.name), ui->listWidget, QListWidgetItem::ItemType::UserType);
-        item->setData(Qt::ItemDataRole::UserRole, (int)task_template.second.id);
+        QListWidgetItem * item = new QListWidgetItem(QString::fromStdString(task_template.name), ui->listWidget, QListWidgetItem::ItemType::UserType);
+        item->setData(Qt::ItemDataRole::UserRole, (int)task_template.id);
         ui->listWidget->addItem(item);
 
-        addUnits(task_template.second.units);
+        addUnits(workspace.get_strings().get(task_template.units));
         ui->unitComboBox->model()->sort(0);
     }
     ui->listWidget->sortItems();
@@ -82,13 +82,13 @@ void EditTemplates::on_listWidget_currentItemChanged(QListWidgetItem *current, Q
     if (current != nullptr)
     {
         int id = current->data(Qt::ItemDataRole::UserRole).toInt();
-        if (workspace.get_task_templates().find(id) != workspace.get_task_templates().end())
+        if (workspace.find_task_template(id) != nullptr)
         {
             displaying = true;
             auto & task_template = workspace.get_task_template(id);
             ui->nameLineEdit       ->setText       (QString::fromStdString(               task_template.name                          ));
             ui->descriptionTextEdit->setText       (QString::fromStdString(               task_template.description                   ));
-            ui->unitComboBox       ->setCurrentText(QString::fromStdString(               task_template.units                         ));
+            ui->unitComboBox       ->setCurrentText(workspace.get_strings().qstring(       task_template.units                         ));
             ui->UMDLineEdit        ->setText       (QString::fromStdString(std::to_string(task_template.default_UDM                   )));
             ui->materialLineEdit   ->setText       (QString::fromStdString(std::to_string(task_template.default_material_cost_per_unit)));
             ui->manpowerLineEdit   ->setText       (QString::fromStdString(std::to_string(task_template.default_manpower_cost_per_unit)));
@@ -107,7 +107,7 @@ void EditTemplates::updateTemplate(QListWidgetItem * item)
         return;
 
     int id = item->data(Qt::ItemDataRole::UserRole).toInt();
-    if (id < 0 || id > (int)workspace.get_task_templates().rbegin()->first)
+    if (id < 0 || workspace.find_task_template(id) == nullptr)
         return;
 
     auto & task_template = workspace.get_task_template(id);
@@ -115,21 +115,26 @@ void EditTemplates::updateTemplate(QListWidgetItem * item)
     bool template_changed = false
         | (task_template.name                           != ui->nameLineEdit       ->       text().toStdString())
         | (task_template.description                    != ui->descriptionTextEdit->toPlainText().toStdString())
-        | (task_template.units                          != ui->unitComboBox       ->currentText().toStdString())
+        | (workspace.get_strings().get(task_template.units) != ui->unitComboBox->currentText().toStdString())
         | (task_template.default_UDM                    != ui->UMDLineEdit        ->       text().toFloat    ())
         | (task_template.default_material_cost_per_unit != ui->materialLineEdit   ->       text().toFloat    ())
         | (task_template.default_manpower_cost_per_unit != ui->manpowerLineEdit   ->       text().toFloat    ())
         | (task_template.use_avg                        != ui->avgCheckBox        -> checkState()              )
         ;
     workspace.set_changed(workspace.get_changed() | template_changed);
+    if (template_changed)
+        edited_templates.insert(id);
 
     task_template.name                           = ui->nameLineEdit       ->       text().toStdString();
     task_template.description                    = ui->descriptionTextEdit->toPlainText().toStdString();
-    task_template.units                          = ui->unitComboBox       ->currentText().toStdString();
+    if (template_changed) // interning on every unchanged pass would only grow the table
+        task_template.units                      = workspace.get_strings().intern(ui->unitComboBox->currentText().toStdString());
     task_template.default_UDM                    = ui->UMDLineEdit        ->       text().toFloat    ();
     task_template.default_material_cost_per_unit = ui->materialLineEdit   ->       text().toFloat    ();
     task_template.default_manpower_cost_per_unit = ui->manpowerLineEdit   ->       text().toFloat    ();
     task_template.use_avg                        = ui->avgCheckBox        -> checkState();
+    if (template_changed)
+        workspace.task_template_changed(id);
 }
 
 void EditTemplates::on_nameLineEdit_editingFinished()
@@ -137,7 +142,7 @@ void EditTemplates::on_nameLineEdit_editingFinished()
     if (ui->nameLineEdit->text().length() == 0)
         {
         int id = ui->listWidget->currentItem()->data(Qt::ItemDataRole::UserRole).toInt();
-        if (id < 0 || id > (int)workspace.get_task_templates().rbegin()->first)
+        if (id < 0 || workspace.find_task_template(id) == nullptr)
             return;
         auto & task_template = workspace.get_task_template(id);
 
@@ -167,7 +172,7 @@ void EditTemplates::on_unitComboBox_editTextChanged(const QString &arg1)
 
     ui->unitComboBox->clear();
     for (const auto & task_template : workspace.get_task_templates())
-        addUnits(task_template.second.units);
+        addUnits(workspace.get_strings().get(task_template.units));
     ui->unitComboBox->model()->sort(0);
     ui->unitComboBox->setCurrentText(str);
 
@@ -1,6 +1,8 @@
 #ifndef EDITTEMPLATES_H
 #define EDITTEMPLATES_H
 
+#include <set>
+
 #include <QDialog>
 #include <QListWidgetItem>
 
@@ -16,6 +18,7 @@ class EditTemplates : public QDialog
     bool displaying = false;
     Ui::EditTemplates *ui;
     ganttry::Workspace & workspace;
+    std::set<ganttry::TemplateID> edited_templates;
 
 public:
     explicit EditTemplates(ganttry::Workspace & w, QWidget *parent = nullptr);
@@ -23,6 +26,7 @@ public:
 
     void addUnits(const std::string & s);
     void updateTemplate(QListWidgetItem * item);
+    inline const std::set<ganttry::TemplateID> & get_edited_templates() const { return edited_templates; }
 
 private slots:
     void on_listWidget_customContextMenuRequested(const QPoint &pos);
@@ -0,0 +1,197 @@
+
+#include <unordered_map>
+
+#include "flat_schedule.hpp"
+#include "workspace.hpp"
+
+namespace ganttry
+{
+
+std::shared_ptr<const FlatSchedule::Segment> FlatSchedule::build_segment(Project & project, std::uint32_t parallel_task_threshold)
+{
+    auto result = std::make_shared<Segment>();
+    std::vector<Task_Base*> order = project.topological_order();
+
+    // large projects get their tasks sorted by depth, still parents first
+    if (order.size() >= parallel_task_threshold)
+    {
+        std::unordered_map<TaskID,std::uint32_t> depths;
+        depths.reserve(order.size());
+        std::vector<std::uint32_t> level_sizes;
+        bool cyclic = false;
+        for (Task_Base * task : order)
+        {
+            std::uint32_t depth = 0;
+            for (const ganttry::Dependency & d : task->get_parent_tasks())
+            {
+                auto it = depths.find(d.task_id);
+                if (it != depths.end())
+                    depth = std::max(depth, it->second + 1);
+                else if (project.tasks.count(d.task_id) != 0)
+                    cyclic = true; // parent placed later
+            }
+            depths[task->get_id()] = depth;
+            if (depth >= level_sizes.size())
+                level_sizes.resize(depth + 1, 0);
+            level_sizes[depth]++;
+        }
+
+        if ( ! cyclic)
+        {
+            std::vector<std::uint32_t> level_next(level_sizes.size(), 0);
+            std::uint32_t level_end = 0;
+            for (size_t l=0 ; l<level_sizes.size() ; l++)
+            {
+                level_next[l] = level_end;
+                level_end += level_sizes[l];
+                result->task_level_ends.push_back(level_end);
+            }
+            std::vector<Task_Base*> by_depth(order.size());
+            for (Task_Base * task : order)
+                by_depth[level_next[depths[task->get_id()]]++] = task;
+            order = std::move(by_depth);
+        }
+    }
+    std::unordered_map<TaskID,std::uint32_t> task_index;
+    task_index.reserve(order.size());
+    for (size_t i=0 ; i<order.size() ; i++)
+        task_index[order[i]->get_id()] = i;
+
+    result->tasks.reserve(order.size());
+    for (Task_Base * task_ptr : order)
+    {
+        Task_Base & task = *task_ptr;
+        Task flat_task{};
+        flat_task.id             = task.get_id();
+        flat_task.template_idx   = -1;
+        flat_task.child_project  = -1;
+        flat_task.leveling_delay = task.get_leveling_delay();
+        flat_task.first_parent   = result->dependencies.size();
+
+        switch (task.get_kind())
+        {
+            case KindTimePoint:
+                flat_task.kind         = TimePoint;
+                flat_task.fixed_offset = static_cast<Task_TimePoint&>(task).get_unixtime_start_offset();
+                break;
+            case KindSubProject:
+                flat_task.kind          = SubProject;
+                flat_task.child_project = result->children.size();
+                result->children.push_back(static_cast<Task_SubProject&>(task).get_child());
+                break;
+            case KindTemplated:
+                flat_task.kind            = Templated;
+                flat_task.remaining_units = task.get_unit_count_forecast() - task.get_units_done_count();
+                flat_task.template_idx    = static_cast<Task_Templated&>(task).get_template_id();
+                break;
+        }
+
+        for (const ganttry::Dependency & d : task.get_parent_tasks())
+        {
+            auto it = task_index.find(d.task_id);
+            if (it == task_index.end())
+                continue;
+            result->dependencies.push_back({d.type, it->second});
+        }
+        flat_task.parent_count = result->dependencies.size() - flat_task.first_parent;
+
+        result->tasks.push_back(flat_task);
+    }
+    return result;
+}
+
+FlatSchedule FlatSchedule::build(const Snapshot & snapshot)
+{
+    FlatSchedule result;
+    result.templates  = snapshot.templates;
+    result.level_ends = snapshot.level_ends;
+
+    std::unordered_map<const Project*,int> project_index;
+    size_t task_count = 0, dependency_count = 0;
+    for (size_t p=0 ; p<snapshot.projects.size() ; p++)
+    {
+        project_index[snapshot.projects[p].project] = p;
+        task_count       += snapshot.projects[p].segment->tasks       .size();
+        dependency_count += snapshot.projects[p].segment->dependencies.size();
+    }
+    result.projects    .reserve(snapshot.projects.size());
+    result.tasks       .reserve(task_count);
+    result.dependencies.reserve(dependency_count);
+
+    // the segments one after the other, their indices shifted
+    for (const Snapshot::Entry & entry : snapshot.projects)
+    {
+        const Segment & segment = *entry.segment;
+        std::uint32_t first_task       = result.tasks.size();
+        std::uint32_t first_dependency = result.dependencies.size();
+        result.projects.push_back({entry.project, entry.unixtime_start, first_task, (std::uint32_t)segment.tasks.size(), (std::uint32_t)result.task_level_ends.size(), (std::uint32_t)segment.task_level_ends.size()});
+
+        for (std::uint32_t level_end : segment.task_level_ends)
+            result.task_level_ends.push_back(first_task + level_end);
+        for (Task task : segment.tasks)
+        {
+            task.first_parent += first_dependency;
+            if (task.kind == SubProject)
+            {
+                // a child missing from the snapshot runs for nothing
+                // rather than borrowing another project's duration
+                auto it = project_index.find(segment.children[task.child_project]);
+                task.child_project = it != project_index.end() ? it->second : -1;
+            }
+            if (task.template_idx >= (int)result.templates.size())
+                task.template_idx = -1;
+            result.tasks.push_back(task);
+        }
+        for (Dependency dependency : segment.dependencies)
+        {
+            dependency.task += first_task;
+            result.dependencies.push_back(dependency);
+        }
+    }
+
+    return result;
+}
+
+FlatSchedule FlatSchedule::build(Workspace & workspace, std::uint32_t parallel_task_threshold)
+{
+    return build(FlatScheduleCache(parallel_task_threshold).snapshot(workspace));
+}
+
+FlatSchedule::State FlatSchedule::make_state() const
+{
+    State state;
+    state.starts           .resize(tasks.size(), 0);
+    state.ends             .resize(tasks.size(), 0);
+    state.project_durations.resize(projects.size(), 0);
+    return state;
+}
+
+FlatSchedule::Snapshot FlatScheduleCache::snapshot(Workspace & workspace)
+{
+    FlatSchedule::Snapshot result;
+
+    // same indices as the workspace's
+    for (const TaskTemplate & templ : workspace.get_task_templates())
+        result.templates.push_back({templ.id, workspace.get_task_template_UDM(templ.id), templ.default_UDM, templ.average_UDM});
+
+    // children first, level by level; projects gone since drop out
+    std::unordered_map<const Project*,Entry> kept;
+    for (const std::vector<Project*> & level : workspace.project_levels())
+    {
+        for (Project * project : level)
+        {
+            auto it = segments.find(project);
+            Entry entry = it != segments.end() && it->second.revision == project->schedule_revision
+                        ? std::move(it->second)
+                        : Entry{project->schedule_revision, FlatSchedule::build_segment(*project, parallel_task_threshold)};
+            result.projects.push_back({project, project->get_unixtime_start(), entry.segment});
+            kept[project] = std::move(entry);
+        }
+        result.level_ends.push_back(result.projects.size());
+    }
+    segments = std::move(kept);
+
+    return result;
+}
+
+} // namespace
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+#include "project.hpp"
+#include "thread_pool.hpp"
+
+namespace ganttry
+{
+
+class Workspace;
+
+// Copy of a whole workspace's scheduling inputs in plain arrays.
+// Projects are ordered children first and each project's tasks are
+// ordered parents first, so one linear pass schedules everything.
+// Projects are also grouped by embedding level, see level_ends, and the
+// tasks of large projects by dependency depth, see task_level_ends.
+// The UI thread only takes a Snapshot, joined into the arrays off it.
+struct FlatSchedule
+{
+    enum Kind : std::uint8_t
+    {
+        TimePoint,
+        Templated,
+        SubProject,
+    };
+
+    struct Task
+    {
+        Kind          kind;
+        TaskID        id;
+        nixtime_diff  fixed_offset;    // TimePoint
+        float         remaining_units; // Templated
+        int           template_idx;    // Templated, index in templates or -1
+        int           child_project;   // SubProject, index in projects, -1 when missing
+        nixtime_diff  leveling_delay;
+        std::uint32_t first_parent;
+        std::uint32_t parent_count;
+    };
+    struct Dependency
+    {
+        DependencyType type;
+        std::uint32_t  task; // index in tasks
+    };
+    struct FlatProject
+    {
+        Project *     project;
+        nixtime       unixtime_start;
+        std::uint32_t first_task;
+        std::uint32_t task_count;
+        std::uint32_t first_task_level; // in task_level_ends
+        std::uint32_t task_level_count; // 0 when scheduled serially
+    };
+    struct Template
+    {
+        TemplateID id;
+        float      UDM; // the one durations use, 0 when unknown
+        float      default_UDM;
+        float      average_UDM;
+    };
+
+    // One project's tasks on their own, indexed within the project, and
+    // the projects its subproject tasks embed, by child_project.
+    struct Segment
+    {
+        std::vector<Task>          tasks;
+        std::vector<Dependency>    dependencies;
+        std::vector<std::uint32_t> task_level_ends; // empty when scheduled serially
+        std::vector<Project*>      children;
+    };
+    // What a pass needs from the workspace, projects children first and
+    // grouped like level_ends. Segments are shared between snapshots, so
+    // an unchanged project costs a pointer.
+    struct Snapshot
+    {
+        struct Entry
+        {
+            Project *                      project;
+            nixtime                        unixtime_start;
+            std::shared_ptr<const Segment> segment;
+        };
+        std::vector<Entry>         projects;
+        std::vector<std::uint32_t> level_ends;
+        std::vector<Template>      templates;
+    };
+
+    std::vector<FlatProject> projects;
+    std::vector<Task>        tasks;
+    std::vector<Dependency>  dependencies;
+    std::vector<Template>    templates;
+    // end of each level in projects, the projects of a level embed only
+    // projects of earlier ones
+    std::vector<std::uint32_t> level_ends;
+    // end of each depth level in tasks, for projects of at least
+    // parallel_task_threshold tasks without cycles; the tasks of a level
+    // only depend on tasks of earlier ones
+    std::vector<std::uint32_t> task_level_ends;
+
+    static constexpr std::uint32_t default_parallel_task_threshold = 20000;
+    static constexpr size_t task_chunk = 1024; // smaller levels run inline
+
+    static std::shared_ptr<const Segment> build_segment(Project & project, std::uint32_t parallel_task_threshold);
+    static FlatSchedule build(const Snapshot & snapshot);
+    static FlatSchedule build(Workspace & workspace, std::uint32_t parallel_task_threshold = default_parallel_task_threshold);
+
+    // Flat, copyable output of a pass, indexed like tasks and projects.
+    struct State
+    {
+        std::vector<nixtime_diff> starts;
+        std::vector<nixtime_diff> ends;
+        std::vector<nixtime_diff> project_durations;
+    };
+    State make_state() const;
+
+    inline nixtime_diff templated_duration(const Task & task, float UDM) const
+    {
+        if (UDM == 0)
+            return 86400;
+        return 86400 * (task.remaining_units / UDM);
+    }
+
+    // templated_duration(task_idx) gives the duration of templated tasks,
+    // everything else follows the same rules as Task_Base. Returns the
+    // task's end.
+    template<typename F>
+    nixtime_diff run_task(State & state, F & templated_duration, std::uint32_t i) const
+    {
+        const Task & task = tasks[i];
+        if (task.kind == TimePoint)
+        {
+            state.starts[i] = task.fixed_offset;
+            state.ends  [i] = task.fixed_offset;
+            return task.fixed_offset;
+        }
+
+        nixtime_diff duration = (task.kind == Templated) ? templated_duration(i)
+                              : (task.child_project < 0) ? 0
+                              : state.project_durations[task.child_project];
+
+        nixtime_diff earliest_offset = std::numeric_limits<nixtime_diff>::lowest();
+        nixtime_diff   latest_offset = std::numeric_limits<nixtime_diff>::max();
+        for (std::uint32_t d=task.first_parent, d_end=task.first_parent+task.parent_count ; d<d_end ; d++)
+        {
+            const Dependency & dependency = dependencies[d];
+            if (dependency.type == DependencyType::BeginAfter)
+                earliest_offset = std::max(earliest_offset, state.ends[dependency.task]);
+            else if (dependency.type == DependencyType::BeginWith)
+                earliest_offset = std::max(earliest_offset, state.starts[dependency.task]);
+            else if (dependency.type == DependencyType::EndBefore)
+                latest_offset = std::min(latest_offset, state.starts[dependency.task] - duration);
+            else if (dependency.type == DependencyType::EndWith)
+                latest_offset = std::min(latest_offset, state.ends[dependency.task] - duration);
+        }
+
+        nixtime_diff start;
+        if (  earliest_offset == std::numeric_limits<nixtime_diff>::lowest()
+             && latest_offset == std::numeric_limits<nixtime_diff>::max())
+            start = task.leveling_delay;
+        else if (earliest_offset == std::numeric_limits<nixtime_diff>::lowest())
+            start = latest_offset + task.leveling_delay;
+        else
+            start = earliest_offset + task.leveling_delay;
+
+        state.starts[i] = start;
+        state.ends  [i] = start + duration;
+        return start + duration;
+    }
+
+    template<typename F>
+    void run_project(State & state, F & templated_duration, size_t p) const
+    {
+        const FlatProject & project = projects[p];
+        nixtime_diff end_offset = 0;
+        for (std::uint32_t i=project.first_task, end=project.first_task+project.task_count ; i<end ; i++)
+            end_offset = std::max(end_offset, run_task(state, templated_duration, i));
+        state.project_durations[p] = end_offset;
+    }
+
+    // level by level, the tasks of a level at the same time
+    template<typename F>
+    void run_project(State & state, F & templated_duration, size_t p, ThreadPool & pool) const
+    {
+        const FlatProject & project = projects[p];
+        if (project.task_level_count == 0)
+            return run_project(state, templated_duration, p);
+
+        std::vector<nixtime_diff> worker_ends(pool.size(), 0);
+        std::uint32_t level_begin = project.first_task;
+        for (std::uint32_t l=0 ; l<project.task_level_count ; l++)
+        {
+            std::uint32_t level_end = task_level_ends[project.first_task_level + l];
+            if (level_end - level_begin <= task_chunk)
+            {
+                for (std::uint32_t i=level_begin ; i<level_end ; i++)
+                    worker_ends[0] = std::max(worker_ends[0], run_task(state, templated_duration, i));
+            }
+            else
+            {
+                pool.parallel_for(level_end - level_begin, task_chunk, [&](size_t begin, size_t end, size_t worker)
+                    {
+                        nixtime_diff end_offset = worker_ends[worker];
+                        for (size_t i=level_begin+begin ; i<level_begin+end ; i++)
+                            end_offset = std::max(end_offset, run_task(state, templated_duration, i));
+                        worker_ends[worker] = end_offset;
+                    });
+            }
+            level_begin = level_end;
+        }
+        state.project_durations[p] = *std::max_element(worker_ends.begin(), worker_ends.end());
+    }
+
+    template<typename F>
+    void run(State & state, F && templated_duration) const
+    {
+        for (size_t p=0 ; p<projects.size() ; p++)
+            run_project(state, templated_duration, p);
+    }
+
+    // The projects of a level at the same time, they only read the
+    // durations of earlier levels and write their own tasks. Large
+    // projects go one at a time instead, spreading their own levels.
+    // templated_duration is called from the pool's workers.
+    template<typename F>
+    void run(State & state, F && templated_duration, ThreadPool & pool) const
+    {
+        std::uint32_t level_begin = 0;
+        for (std::uint32_t level_end : level_ends)
+        {
+            std::vector<std::uint32_t> small;
+            for (std::uint32_t p=level_begin ; p<level_end ; p++)
+                if (projects[p].task_level_count > 0)
+                    run_project(state, templated_duration, p, pool);
+                else
+                    small.push_back(p);
+
+            if (small.size() == 1)
+                run_project(state, templated_duration, small[0]);
+            else if (small.size() > 1)
+                pool.parallel_for(small.size(), 1, [&](size_t begin, size_t end, size_t)
+                    {
+                        for (size_t i=begin ; i<end ; i++)
+                            run_project(state, templated_duration, small[i]);
+                    });
+            level_begin = level_end;
+        }
+    }
+
+    // deterministic pass with each template's current UDM
+    inline nixtime_diff current_duration(std::uint32_t i) const
+    {
+        const Task & task = tasks[i];
+        return templated_duration(task, task.template_idx < 0 ? 0 : templates[task.template_idx].UDM);
+    }
+    inline void run(State & state) const
+    {
+        run(state, [&](std::uint32_t i) { return current_duration(i); });
+    }
+    inline void run(State & state, ThreadPool & pool) const
+    {
+        run(state, [&](std::uint32_t i) { return current_duration(i); }, pool);
+    }
+};
+
+// Keeps each project's segment until its schedule_revision moves, so a
+// snapshot after an edit flattens the edited project only. Belongs to one
+// workspace, clear it when switching.
+class FlatScheduleCache
+{
+    struct Entry
+    {
+        std::uint64_t                                revision;
+        std::shared_ptr<const FlatSchedule::Segment> segment;
+    };
+
+    std::unordered_map<const Project*,Entry> segments;
+    std::uint32_t parallel_task_threshold;
+
+public:
+    inline explicit FlatScheduleCache(std::uint32_t parallel_task_threshold_ = FlatSchedule::default_parallel_task_threshold)
+        : parallel_task_threshold(parallel_task_threshold_)
+    {}
+
+    FlatSchedule::Snapshot snapshot(Workspace & workspace);
+    inline void clear() { segments.clear(); }
+};
+
+} // namespace
@@ -0,0 +1,200 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include <QTransform>
+#include <QVector2D>
+
+#include "gantt_layout.hpp"
+
+namespace ganttry
+{
+
+size_t GanttLayout::first_row(qreal y) const
+{
+    return std::lower_bound(rows.begin(), rows.end(), y, [](const Row & row, qreal y) { return row.top + row.height < y; }) - rows.begin();
+}
+
+static int arrow_band(qreal y)
+{
+    return std::max(0, (int)std::floor(y / GanttLayout::arrow_band_height));
+}
+
+void GanttLayout::index_arrows()
+{
+    arrow_bands.clear();
+    for (std::uint32_t i=0 ; i<arrows.size() ; i++)
+    {
+        QRectF bounds = arrow_bounds(arrows[i]);
+        int last = arrow_band(bounds.bottom());
+        if ((int)arrow_bands.size() <= last)
+            arrow_bands.resize(last + 1);
+        for (int band=arrow_band(bounds.top()) ; band<=last ; band++)
+            arrow_bands[band].push_back(i);
+    }
+}
+
+QPen arrow_pen(bool highlighted)
+{
+    QPen pen = highlighted ? QPen(QColor(100,237,149,255)) : QPen(QColor(255,0,0,128));
+    pen.setWidth(highlighted ? 3 : 2);
+    return pen;
+}
+
+bool arrow_path(QPointF from, QPointF to, qreal width, qreal height, QPainterPath & path)
+{
+    // guard against creating items over the border that would expande the scene
+    if ( to.x() < 3 || to.x() > width -3
+       ||to.y() < 3 || to.y() > height-3)
+    {
+        return false;
+    }
+
+    path = QPainterPath(QPointF(from.x(), from.y()));
+    path.lineTo(to.x(), to.y());
+
+    QTransform rotation1 = QTransform().rotate(30);
+    QTransform rotation2 = QTransform().rotate(-30);
+    QVector2D vec1(rotation1.map(QPointF(from.x()-to.x(), from.y()-to.y())));
+    QVector2D vec2(rotation2.map(QPointF(from.x()-to.x(), from.y()-to.y())));
+
+    vec1.normalize();
+    vec1 *= 10.0;
+    vec2.normalize();
+    vec2 *= 10.0;
+
+    if (  to.x()+vec1.x() > 3 && to.x()+vec1.x() < width -4
+       && to.y()+vec1.y() > 3 && to.y()+vec1.y() < height-4)
+    {
+        path.lineTo(to.x()+vec1.x(), to.y()+vec1.y());
+    }
+    if (  to.x()+vec2.x() > 3 && to.x()+vec2.x() < width -4
+       && to.y()+vec2.y() > 3 && to.y()+vec2.y() < height-4)
+    {
+        path.moveTo(to.x(), to.y());
+        path.lineTo(to.x()+vec2.x(), to.y()+vec2.y());
+    }
+
+    return true;
+}
+
+QRectF arrow_bounds(const GanttLayout::Arrow & arrow)
+{
+    // head and pen included
+    return QRectF(arrow.from, arrow.to).normalized().adjusted(-12, -12, 12, 12);
+}
+
+void paint_gantt(QPainter & painter, const GanttLayout & layout, const QRectF & exposed)
+{
+    static const QColor grid_color (200,200,200,255);
+    static const QColor shade_color(  0,  0,  0, 20);
+    static const QColor bar_color  (100,149,237,255);
+
+    int right  = layout.width  - 1;
+    int bottom = layout.height - 1;
+
+    size_t first = layout.first_row(exposed.top());
+    size_t last  = first;
+    while (last < layout.rows.size() && layout.rows[last].top <= exposed.bottom())
+        last++;
+
+    // gray subtasks
+    painter.setPen(shade_color);
+    painter.setBrush(shade_color);
+    for (size_t i=first ; i<last ; i++)
+        if (layout.rows[i].shaded)
+            painter.drawRect(0, layout.rows[i].top, right, layout.rows[i].height);
+
+    // horizontal lines
+    painter.setPen(grid_color);
+    for (size_t i=first ; i<last ; i++)
+        painter.drawLine(0, layout.rows[i].top, right, layout.rows[i].top);
+    if ( ! layout.rows.empty() && last == layout.rows.size())
+    {
+        int y = layout.rows.back().top + layout.rows.back().height;
+        painter.drawLine(0, y, right, y);
+    }
+
+    // vertical lines
+    for (auto it = std::lower_bound(layout.columns.begin(), layout.columns.end(), (int)std::floor(exposed.left())) ; it != layout.columns.end() && *it <= exposed.right() ; ++it)
+        painter.drawLine(*it, 0, *it, bottom);
+
+    // density strips, runs of equal density in one rect
+    auto strip = std::lower_bound(layout.strips.begin(), layout.strips.end(), first, [](const GanttLayout::Strip & strip, size_t row) { return strip.row < row; });
+    for ( ; strip != layout.strips.end() && strip->row < last ; ++strip)
+    {
+        const GanttLayout::Row & row = layout.rows[strip->row];
+        for (size_t begin=0, end ; begin<strip->density.size() ; begin=end)
+        {
+            std::uint16_t density = strip->density[begin];
+            for (end=begin+1 ; end<strip->density.size() && strip->density[end] == density ; end++)
+                ;
+            if (density == 0)
+                continue;
+            QColor color = bar_color;
+            color.setAlpha(60 + 195 * density / strip->peak);
+            painter.fillRect(strip->x + (int)begin, row.top+4, (int)(end-begin), row.height-8, color);
+        }
+    }
+
+    // bars
+    for (size_t i=first ; i<last ; i++)
+    {
+        const GanttLayout::Row & row = layout.rows[i];
+        const GanttLayout::Bar & bar = layout.bars[i];
+        int middle = row.top + row.height/2;
+        switch (bar.kind)
+        {
+            case GanttLayout::Templated:
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(bar_color);
+                painter.drawRect(bar.x1, row.top+4, bar.x2-bar.x1, row.height-8);
+                break;
+            case GanttLayout::SubProject:
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(Qt::black);
+                painter.drawRect(bar.x1, middle-2, bar.x2-bar.x1, 4);
+                break;
+            case GanttLayout::Collapsed:
+                painter.setPen(Qt::black);
+                painter.setBrush(Qt::NoBrush);
+                painter.drawRect(bar.x1, row.top+4, bar.x2-bar.x1, row.height-8);
+                break;
+            case GanttLayout::TimePoint:
+            case GanttLayout::ProjectStart:
+            {
+                // an 8x8 square turned by 45 degrees
+                const qreal r = 4 * std::sqrt(2.0);
+                QPointF diamond[4] = { {bar.x1 - r, (qreal)middle}, {(qreal)bar.x1, middle - r}, {bar.x1 + r, (qreal)middle}, {(qreal)bar.x1, middle + r} };
+                painter.setPen(Qt::black);
+                if (bar.kind == GanttLayout::ProjectStart)
+                    painter.setBrush(Qt::black);
+                else
+                    painter.setBrush(Qt::NoBrush);
+                painter.drawPolygon(diamond, 4);
+                break;
+            }
+        }
+    }
+
+    // dependency arrows, the highlighted ones are an overlay of the scene
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(arrow_pen(false));
+    int first_band = arrow_band(exposed.top());
+    int last_band  = std::min(arrow_band(exposed.bottom()), (int)layout.arrow_bands.size() - 1);
+    for (int band=first_band ; band<=last_band ; band++)
+        for (std::uint32_t i : layout.arrow_bands[band])
+        {
+            const GanttLayout::Arrow & arrow = layout.arrows[i];
+            QRectF bounds = arrow_bounds(arrow);
+            // an arrow crossing several exposed bands is drawn from the first
+            if (std::max(arrow_band(bounds.top()), first_band) != band || ! bounds.intersects(exposed))
+                continue;
+            QPainterPath path;
+            if ( ! arrow_path(arrow.from, arrow.to, layout.width, layout.height, path))
+                continue;
+            painter.drawPath(path);
+        }
+}
+
+} // namespace
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+#include <QPainter>
+#include <QPainterPath>
+
+namespace ganttry
+{
+
+// Everything the gantt layer draws, as plain arrays. Rows are sorted top
+// to bottom and columns left to right, so painting can go straight to
+// the exposed part instead of walking every task.
+struct GanttLayout
+{
+    enum BarKind : std::uint8_t
+    {
+        Templated,
+        SubProject,
+        TimePoint,
+        ProjectStart,
+        Collapsed, // subproject without child rows, with a density strip when zoomed out
+    };
+
+    struct Row
+    {
+        int  top;
+        int  height;
+        bool shaded; // inside a subproject
+    };
+    struct Bar
+    {
+        int     x1;
+        int     x2;
+        BarKind kind;
+    };
+    // how many tasks of a collapsed subproject run at each pixel
+    struct Strip
+    {
+        std::uint32_t              row;
+        int                        x;
+        std::uint16_t              peak;
+        std::vector<std::uint16_t> density;
+    };
+    struct Arrow
+    {
+        QPointF from;
+        QPointF to;
+    };
+
+    int width  = 0; // scene size
+    int height = 0;
+    std::vector<Row>   rows;
+    std::vector<Bar>   bars;    // one per row
+    std::vector<int>   columns; // x of the vertical grid lines
+    std::vector<Strip> strips;  // by row
+    std::vector<Arrow> arrows;
+    // arrow indices by the bands of arrow_band_height their bounds cross,
+    // so a tile only looks at the arrows of its own bands
+    static constexpr int arrow_band_height = 256;
+    std::vector<std::vector<std::uint32_t>> arrow_bands;
+
+    // first row reaching down to y
+    size_t first_row(qreal y) const;
+    // fills arrow_bands, once the arrows are in
+    void index_arrows();
+};
+
+QPen arrow_pen(bool highlighted);
+// false when the tip would fall outside of width x height
+bool arrow_path(QPointF from, QPointF to, qreal width, qreal height, QPainterPath & path);
+QRectF arrow_bounds(const GanttLayout::Arrow & arrow);
+
+void paint_gantt(QPainter & painter, const GanttLayout & layout, const QRectF & exposed);
+
+} // namespace
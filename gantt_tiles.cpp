@@ -0,0 +1,284 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include <QPaintDevice>
+#include <QRegion>
+
+#include "gantt_tiles.hpp"
+
+namespace ganttry
+{
+
+GanttTileCache::GanttTileCache(std::function<void(QRect)> on_rendered_)
+    : on_rendered(std::move(on_rendered_))
+    , thread([this]() { loop(); })
+{}
+
+GanttTileCache::~GanttTileCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void GanttTileCache::set_layout(std::shared_ptr<const GanttLayout> new_layout, int new_zoom)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const GanttLayout> old_layout = std::move(layout);
+    layout = std::move(new_layout);
+    generation++;
+
+    size_t band_count = std::max(old_layout ? old_layout->height : 0, layout->height) / tile_size + 1;
+    band_generations.resize(band_count, generation);
+
+    if ( ! old_layout
+       || zoom != new_zoom
+       || old_layout->width   != layout->width
+       || old_layout->columns != layout->columns
+       )
+    {
+        zoom = new_zoom;
+        std::fill(band_generations.begin(), band_generations.end(), generation);
+        drop_stale_tiles();
+        return;
+    }
+    const GanttLayout & old = *old_layout;
+
+    auto invalidate_row = [&](const GanttLayout & l, size_t i)
+        {
+            invalidate_bands(l.rows[i].top, l.rows[i].top + l.rows[i].height);
+        };
+
+    // rows and bars, a row moved by an insertion above it counts as changed
+    for (size_t i=0 ; i<std::max(old.rows.size(), layout->rows.size()) ; i++)
+    {
+        bool in_old = i < old    .rows.size();
+        bool in_new = i < layout->rows.size();
+        if (in_old && in_new
+           && old.rows[i].top    == layout->rows[i].top
+           && old.rows[i].height == layout->rows[i].height
+           && old.rows[i].shaded == layout->rows[i].shaded
+           && old.bars[i].x1     == layout->bars[i].x1
+           && old.bars[i].x2     == layout->bars[i].x2
+           && old.bars[i].kind   == layout->bars[i].kind
+           )
+        {
+            continue;
+        }
+        if (in_old) invalidate_row(old    , i);
+        if (in_new) invalidate_row(*layout, i);
+    }
+
+    // density strips, both sorted by row
+    auto o = old.strips.begin();
+    auto n = layout->strips.begin();
+    while (o != old.strips.end() || n != layout->strips.end())
+    {
+        if (n == layout->strips.end() || (o != old.strips.end() && o->row < n->row))
+        {
+            invalidate_row(old, (o++)->row);
+        }
+        else if (o == old.strips.end() || n->row < o->row)
+        {
+            invalidate_row(*layout, (n++)->row);
+        }
+        else
+        {
+            if (o->x != n->x || o->peak != n->peak || o->density != n->density)
+            {
+                invalidate_row(old    , o->row);
+                invalidate_row(*layout, n->row);
+            }
+            ++o;
+            ++n;
+        }
+    }
+
+    // arrows
+    for (size_t i=0 ; i<std::max(old.arrows.size(), layout->arrows.size()) ; i++)
+    {
+        bool in_old = i < old    .arrows.size();
+        bool in_new = i < layout->arrows.size();
+        if (in_old && in_new
+           && old.arrows[i].from == layout->arrows[i].from
+           && old.arrows[i].to   == layout->arrows[i].to
+           )
+        {
+            continue;
+        }
+        if (in_old) { QRectF r = arrow_bounds(old    .arrows[i]); invalidate_bands(r.top(), r.bottom()); }
+        if (in_new) { QRectF r = arrow_bounds(layout->arrows[i]); invalidate_bands(r.top(), r.bottom()); }
+    }
+
+    // grid lines reach the bottom, arrow heads are clipped near it
+    if (old.height != layout->height)
+        invalidate_bands(std::min(old.height, layout->height) - 12, std::max(old.height, layout->height));
+
+    drop_stale_tiles();
+}
+
+void GanttTileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    layout.reset();
+    band_generations.clear();
+    tiles.clear();
+    requests.clear();
+}
+
+void GanttTileCache::invalidate_bands(qreal top, qreal bottom)
+{
+    if (band_generations.empty())
+        return;
+    int first = std::clamp((int)std::floor(top    / tile_size), 0, (int)band_generations.size() - 1);
+    int last  = std::clamp((int)std::floor(bottom / tile_size), 0, (int)band_generations.size() - 1);
+    for (int ty=first ; ty<=last ; ty++)
+        band_generations[ty] = generation;
+}
+
+bool GanttTileCache::current(const Key & k) const
+{
+    auto [tile_zoom, tx, ty, tile_generation] = k;
+    return tile_zoom == zoom && ty < (int)band_generations.size() && band_generations[ty] == tile_generation;
+}
+
+void GanttTileCache::drop_stale_tiles()
+{
+    for (auto it = tiles.begin() ; it != tiles.end() ; )
+        it = current(it->first) ? std::next(it) : tiles.erase(it);
+    requests.erase(std::remove_if(requests.begin(), requests.end(), [this](const Key & k) { return ! current(k); }), requests.end());
+}
+
+void GanttTileCache::paint(QPainter & painter, const QRectF & exposed)
+{
+    std::shared_ptr<const GanttLayout> snapshot;
+    std::vector<std::tuple<QRect,QImage>> blits;
+    QRegion direct;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot = layout;
+        if ( ! snapshot)
+            return;
+
+        // tiles only match the device when drawn unscaled
+        if (painter.worldTransform().type() > QTransform::TxTranslate)
+        {
+            direct = exposed.toAlignedRect();
+        }
+        else
+        {
+            qreal ratio = painter.device()->devicePixelRatioF();
+            if (ratio != pixel_ratio)
+            {
+                pixel_ratio = ratio;
+                tiles.clear();
+                requests.clear();
+            }
+            paint_count++;
+
+            int max_tx = std::max(snapshot->width - 1, 0) / tile_size;
+            int max_ty = (int)band_generations.size() - 1;
+            int tx1 = std::clamp((int)std::floor(exposed.left  () / tile_size), 0, max_tx);
+            int tx2 = std::clamp((int)std::floor(exposed.right () / tile_size), 0, max_tx);
+            int ty1 = std::clamp((int)std::floor(exposed.top   () / tile_size), 0, max_ty);
+            int ty2 = std::clamp((int)std::floor(exposed.bottom() / tile_size), 0, max_ty);
+
+            // exposed tiles first, then one ring around them ahead of scrolling
+            std::vector<Key> missing;
+            for (int ty=ty1 ; ty<=ty2 ; ty++)
+                for (int tx=tx1 ; tx<=tx2 ; tx++)
+                {
+                    Key k = key(tx, ty);
+                    auto it = tiles.find(k);
+                    if (it == tiles.end())
+                    {
+                        direct += tile_rect(k);
+                        missing.push_back(k);
+                        continue;
+                    }
+                    it->second.used = paint_count;
+                    blits.push_back({tile_rect(k), it->second.image});
+                }
+            for (int ty=std::max(ty1-1, 0) ; ty<=std::min(ty2+1, max_ty) ; ty++)
+                for (int tx=std::max(tx1-1, 0) ; tx<=std::min(tx2+1, max_tx) ; tx++)
+                    if ((ty < ty1 || ty > ty2 || tx < tx1 || tx > tx2) && tiles.count(key(tx, ty)) == 0)
+                        missing.push_back(key(tx, ty));
+
+            for (auto it = missing.rbegin() ; it != missing.rend() ; ++it)
+            {
+                auto queued = std::find(requests.begin(), requests.end(), *it);
+                if (queued != requests.end())
+                    requests.erase(queued);
+                requests.push_front(*it);
+            }
+            while (requests.size() > 64)
+                requests.pop_back();
+            if ( ! missing.empty())
+                cv.notify_one();
+        }
+    }
+
+    for (const auto & [rect, image] : blits)
+        painter.drawImage(rect.topLeft(), image);
+
+    if ( ! direct.isEmpty())
+    {
+        painter.save();
+        painter.setClipRegion(direct, Qt::IntersectClip);
+        paint_gantt(painter, *snapshot, exposed.intersected(direct.boundingRect()));
+        painter.restore();
+    }
+}
+
+void GanttTileCache::loop()
+{
+    for (;;)
+    {
+        Key k;
+        std::shared_ptr<const GanttLayout> snapshot;
+        qreal ratio;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return stopping || ! requests.empty(); });
+            if (stopping)
+                return;
+            k = requests.front();
+            requests.pop_front();
+            if (tiles.count(k) != 0 || ! layout)
+                continue;
+            snapshot = layout;
+            ratio = pixel_ratio;
+        }
+
+        QRect rect = tile_rect(k);
+        int pixels = std::ceil(tile_size * ratio);
+        QImage image(pixels, pixels, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(ratio);
+        image.fill(Qt::transparent);
+        {
+            QPainter painter(&image);
+            painter.translate(-rect.topLeft());
+            painter.setClipRect(rect);
+            paint_gantt(painter, *snapshot, rect);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // its band changed while rendering
+            if ( ! current(k) || ratio != pixel_ratio)
+                continue;
+            tiles[k] = {std::move(image), paint_count};
+
+            while (tiles.size() > max_tiles)
+                tiles.erase(std::min_element(tiles.begin(), tiles.end(), [](const auto & left, const auto & right) { return left.second.used < right.second.used; }));
+        }
+        if (on_rendered)
+            on_rendered(rect);
+    }
+}
+
+} // namespace
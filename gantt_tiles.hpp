@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <QImage>
+
+#include "gantt_layout.hpp"
+
+namespace ganttry
+{
+
+// Raster copies of the gantt layer in fixed size tiles, rendered on a
+// worker thread. Every band of tiles (one tile row) has a generation that
+// is bumped when a new layout changes any row, strip or arrow crossing it,
+// so the other bands keep their tiles. Tiles that are not ready yet are
+// painted directly and queued; on_rendered gets the scene rect of each
+// finished tile and is called from the worker thread.
+class GanttTileCache
+{
+public:
+    static constexpr int tile_size = 256;
+    static constexpr size_t max_tiles = 256; // 64MB at a pixel ratio of 1
+
+private:
+    // zoom, tile x, tile y, band generation
+    using Key = std::tuple<int,int,int,std::uint64_t>;
+
+    struct Tile
+    {
+        QImage        image;
+        std::uint64_t used; // last paint it was blitted in
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::shared_ptr<const GanttLayout> layout;
+    int zoom = 0;
+    qreal pixel_ratio = 1;
+    std::vector<std::uint64_t> band_generations;
+    std::uint64_t generation = 0;
+    std::uint64_t paint_count = 0;
+    std::map<Key,Tile> tiles;
+    std::deque<Key> requests; // most recently exposed first
+    bool stopping = false;
+
+    std::function<void(QRect)> on_rendered;
+    std::thread thread;
+
+    void loop();
+    bool current(const Key & k) const;
+    void invalidate_bands(qreal top, qreal bottom);
+    void drop_stale_tiles();
+    inline QRect tile_rect(const Key & key) const { return QRect(std::get<1>(key)*tile_size, std::get<2>(key)*tile_size, tile_size, tile_size); }
+    inline Key key(int tx, int ty) const { return {zoom, tx, ty, band_generations[ty]}; }
+
+public:
+    explicit GanttTileCache(std::function<void(QRect)> on_rendered);
+    ~GanttTileCache();
+
+    // keeps the tiles of every band the new layout draws the same
+    void set_layout(std::shared_ptr<const GanttLayout> layout, int zoom);
+    void clear();
+
+    void paint(QPainter & painter, const QRectF & exposed);
+};
+
+} // namespace
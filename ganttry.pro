@@ -1,4 +1,4 @@
-QT       += core gui sql
+QT       += core gui sql svg
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -9,19 +9,45 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    chart_export.cpp \
+    costs.cpp \
+    earned_value.cpp \
     edittemplates.cpp \
+    flat_schedule.cpp \
+    gantt_layout.cpp \
+    gantt_tiles.cpp \
     ganttry_graphics.cpp \
+    leveling.cpp \
     main.cpp \
     mainwindow.cpp \
     project.cpp \
+    redraw_scheduler.cpp \
+    schedule_worker.cpp \
+    simulation.cpp \
+    string_table.cpp \
+    template_stats.cpp \
+    thread_pool.cpp \
     workspace.cpp
 
 HEADERS += \
+    chart_export.hpp \
+    costs.hpp \
+    earned_value.hpp \
     edittemplates.h \
+    flat_schedule.hpp \
+    gantt_layout.hpp \
+    gantt_tiles.hpp \
     ganttry_graphics.hpp \
+    leveling.hpp \
     mainwindow.h \
     myset.hpp \
     project.hpp \
+    redraw_scheduler.hpp \
+    schedule_worker.hpp \
+    simulation.hpp \
+    string_table.hpp \
+    template_stats.hpp \
+    thread_pool.hpp \
     types.hpp \
     workspace.hpp
 
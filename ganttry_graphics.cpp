@@ -12,7 +12,8 @@
 #include <QList>
 #include <QScrollBar>
 #include <QPainterPath>
-#include <QVector2D>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QTransform>
 #include <QMessageBox>
 
@@ -21,6 +22,14 @@
 namespace ganttry
 {
 
+// size of the scene's view, empty when drawn without one (export)
+static QSize viewport_size(const QGraphicsScene & scene)
+{
+    if (scene.views().empty())
+        return QSize(0, 0);
+    return scene.views()[0]->viewport()->size();
+}
+
 void NamesGraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 {
     QMenu menu(event->widget());
@@ -28,6 +37,7 @@ void NamesGraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
     QAction * action_add_time_point = menu.addAction("Add Time point");
     QMenu * action_menu_project = menu.addMenu("Add Project as Task");
     QAction * action_delete_task = menu.addAction("Delete Task");
+    QAction * action_toggle_row = menu.addAction("Expand");
     std::vector<std::pair<QAction*,Project&>> projects_actions;
     projects_actions.reserve(project->workspace.get_projects().size());
     for(auto & proj : project->workspace.get_projects())
@@ -50,6 +60,12 @@ void NamesGraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
     if (task_id == 0)
         action_delete_task->setEnabled(false);
 
+    // expand/collapse subproject
+    bool is_subproject = row_id != -1 && rows_info()[row_id].task->is_recursive();
+    action_toggle_row->setEnabled(is_subproject);
+    if (is_subproject && is_expanded(rows_info()[row_id]))
+        action_toggle_row->setText("Collapse");
+
     auto action = menu.exec(event->screenPos());
     if (action == action_add_task)
     {
@@ -65,10 +81,14 @@ void NamesGraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
     }
     else if (action == action_delete_task)
     {
-        project->remove_task(task_id);
         gantt_scene->unselect_row();
-        redraw();
-        gantt_scene->redraw();
+        project->remove_task(task_id);
+        emit taskRemoved(project, task_id); // redraws the rows
+    }
+    else if (action == action_toggle_row)
+    {
+        if (toggle_row(row_id))
+            emit rowToggled(row_id);
     }
     else // something in submenu
     {
@@ -89,6 +109,54 @@ void GanttGraphicsScene::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 {
 }
 
+void NameLabelsItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget *)
+{
+    QRectF exposed = option->exposedRect;
+    auto it = std::lower_bound(labels.begin(), labels.end(), exposed.top(), [](const Label & label, qreal top) { return label.pos.y() + label.height < top; });
+
+    auto first = it;
+    qreal right = bounds.width();
+
+    // gray subtasks and horizontal lines
+    painter->setPen(QColor(200,200,200,255));
+    for (it = first ; it != labels.end() && it->pos.y() <= exposed.bottom() ; ++it)
+    {
+        if (it->shaded)
+            painter->fillRect(QRectF(0, it->pos.y(), right, it->height), QColor(0,0,0,20));
+        painter->drawLine(QPointF(0, it->pos.y()), QPointF(right, it->pos.y()));
+    }
+    if (it == labels.end() && ! labels.empty())
+        painter->drawLine(QPointF(0, bounds.bottom()), QPointF(right, bounds.bottom()));
+
+    painter->setPen(Qt::black);
+    const QFont * font = nullptr;
+    for (it = first ; it != labels.end() && it->pos.y() <= exposed.bottom() ; ++it)
+    {
+        if (it->font != font)
+        {
+            font = it->font;
+            painter->setFont(*font);
+        }
+        painter->drawStaticText(it->pos + QPointF(4, 4), *it->text); // text items' document margin
+    }
+}
+
+const NamesGraphicsScene::CachedLabel & NamesGraphicsScene::get_label(StringID name, int depth)
+{
+    int font_idx = depth > 0 ? 1 : 0;
+    auto [it,b] = label_cache.insert({{name, font_idx}, {}});
+    CachedLabel & label = it->second;
+    if (b)
+    {
+        label.text.setText(project->workspace.get_strings().qstring(name));
+        label.text.setTextFormat(Qt::PlainText);
+        label.text.prepare(QTransform(), label_fonts[font_idx]);
+        label.height = QFontMetrics(label_fonts[font_idx]).height() + 8;
+    }
+    label.used = redraw_count;
+    return label;
+}
+
 void NamesGraphicsScene::redraw()
 {
     static const int indent = 20;
@@ -103,9 +171,26 @@ void NamesGraphicsScene::redraw()
     if (project->tasks.empty())
         return;
 
-    int width = this->views()[0]->viewport()->width() - 1;
+    int width = viewport_size(*this).width() - 1;
     qreal total_height(0);
 
+    // labels are shaped once per name and font
+    ++redraw_count;
+    QFont font = this->font();
+    if (label_cache.empty() || font != label_fonts[0] || label_strings != project->workspace.get_strings().get_serial())
+    {
+        label_cache.clear();
+        label_strings = project->workspace.get_strings().get_serial();
+        label_fonts[0] = font;
+        label_fonts[1] = font;
+        label_fonts[1].setPointSize(font.pointSize()-2); // subtasks with smaller font
+    }
+    NameLabelsItem * labels_item = new NameLabelsItem();
+
+    // project durations, computed once and shared by every embedding
+    project->workspace.update_project_durations();
+    auto duration_of = [](const Project & proj) { return proj.duration_in_seconds(); };
+
     // text
     std::function<void(ganttry::Project &, int, std::vector<std::tuple<TaskID,Project*>>, uint64_t)> redraw_project;
     redraw_project = [&](ganttry::Project & project, int depth, std::vector<std::tuple<TaskID,Project*>> project_tree_path, std::uint64_t base_start_time)
@@ -116,7 +201,9 @@ void NamesGraphicsScene::redraw()
                 std::uint64_t nx_end_time   = [&]()
                     {
                         if (task.first == 0)
-                            return nx_start_time + project.duration_in_seconds();
+                            return nx_start_time + duration_of(project);
+                        else if (task.second->is_recursive())
+                            return nx_start_time + duration_of(*task.second->get_child());
                         else
                             return base_start_time + task.second->get_unixtime_end_offset();
                     }();
@@ -125,55 +212,53 @@ void NamesGraphicsScene::redraw()
                         if (task.first == 0)
                             return nx_start_time + project.get_unixtime_earliest_offset();
                         else if (task.second->is_recursive())
-                            return nx_start_time + (dynamic_cast<Task_SubProject*>(task.second.get()))->get_child()->get_unixtime_earliest_offset();
+                            return nx_start_time + task.second->get_child()->get_unixtime_earliest_offset();
                         else
                             return nx_start_time;
                     }();
 
-                QFont font = this->font();
-                if (depth > 0) // subtasks with smaller font
-                    font.setPointSize(font.pointSize()-2);
-                QGraphicsTextItem * item = this->addText(QString::fromStdString(task.second->get_full_display_name()), font);
-                item->setPos(depth*indent, total_height);
-                rows_info_.push_back(row_info{(int)item->boundingRect().height(), depth, project_tree_path, task.second.get(), nx_earliest_time, nx_start_time, nx_end_time});
-                if (depth > 0) // gray subtasks
-                    this->addRect(0, total_height, width, (int)item->boundingRect().height(), QPen(QColor(0,0,0,20)),QBrush(QColor(0,0,0,20)));
-                total_height += item->boundingRect().height();
+                const CachedLabel & label = get_label(task.second->get_display_name_id(), depth);
+                labels_item->labels.push_back({&label.text, &label_fonts[depth > 0 ? 1 : 0], QPointF(depth*indent, total_height), label.height, depth > 0});
+                rows_info_.push_back(row_info{label.height, depth, project_tree_path, task.second.get(), nx_earliest_time, nx_start_time, nx_end_time, false});
+                total_height += label.height;
 
+                // child rows only for opened subprojects
                 if (task.second->is_recursive())
                 {
-                    Project & subproject = *task.second->get_child();
-                    std::vector<std::tuple<TaskID,Project*>> project_tree_path_copy = project_tree_path;
-                    project_tree_path_copy.push_back({task.second->get_id(), &subproject});
-                    redraw_project(*task.second->get_child(), depth+1, project_tree_path_copy, base_start_time + task.second->get_unixtime_start_offset());
+                    rows_info_.back().collapsed = ! is_expanded(rows_info_.back());
+                    if ( ! rows_info_.back().collapsed)
+                        redraw_project(*task.second->get_child(), depth+1, child_path(rows_info_.back()), nx_start_time);
                 }
             }
         };
     redraw_project(*project, 0, {{0,project}}, project->get_unixtime_start());
 
-    //horizontal lines
-    {
-        setSceneRect(0, 0, width, total_height);
-        int total_height = 0;
-        for (const auto & row_info : rows_info_)
-        {
-            this->addLine(0, total_height, width, total_height, QPen(QColor(200,200,200,255)));
-            total_height += row_info.height;
-        }
-        this->addLine(0, total_height, width, total_height, QPen(QColor(200,200,200,255)));
-    }
+    // without a view, as wide as the longest name
+    if (views().empty())
+        for (const NameLabelsItem::Label & label : labels_item->labels)
+            width = std::max(width, (int)std::ceil(label.pos.x() + 8 + label.text->size().width()));
+
+    labels_item->bounds = QRectF(0, 0, width, total_height);
+    this->addItem(labels_item);
+    setSceneRect(0, 0, width, total_height);
+
+    // forget names that are gone, once they pile up
+    if (label_cache.size() > 2 * rows_info_.size())
+        for (auto it = label_cache.begin() ; it != label_cache.end() ; )
+            if (it->second.used != redraw_count)
+                it = label_cache.erase(it);
+            else
+                ++it;
 
     // selection
+    selection_rect = this->addRect(QRectF(), QPen(QColor(0,0,0,55)),QBrush(QColor(0,0,0,55)));
+    selection_rect->setZValue(1);
+    selection_rect->setVisible(false);
     if (gantt_scene->get_selected_row_id() != -1)
     {
         int total_height = std::accumulate(rows_info_.begin(), rows_info_.begin()+gantt_scene->get_selected_row_id(), 0, [](int v, const row_info & left){ return v+left.height; });
-
-        // update selection
-        //if (selection_rect) {
-        //    this->removeItem(selection_rect);
-        //    selection_rect = nullptr;
-        //}
-        selection_rect = this->addRect(0, total_height, width, rows_info_[gantt_scene->get_selected_row_id()].height, QPen(QColor(0,0,0,55)),QBrush(QColor(0,0,0,55)));
+        selection_rect->setRect(0, total_height, width, rows_info_[gantt_scene->get_selected_row_id()].height);
+        selection_rect->setVisible(true);
     }
 }
 void NamesGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
@@ -195,15 +280,43 @@ void NamesGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
 
     gantt_scene->row_left_clicked(scene_point.y());
 }
+void NamesGraphicsScene::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *mouseEvent)
+{
+    if (mouseEvent->button() != Qt::MouseButton::LeftButton)
+        return;
+    auto [row_id,dummy] = gantt_scene->get_item_id(mouseEvent->scenePos().y());
+    if (toggle_row(row_id))
+        emit rowToggled(row_id);
+}
+std::vector<std::tuple<TaskID,Project*>> NamesGraphicsScene::child_path(const row_info & info) const
+{
+    std::vector<std::tuple<TaskID,Project*>> path = info.project_tree_path;
+    path.push_back({info.task->get_id(), info.task->get_child()});
+    return path;
+}
+bool NamesGraphicsScene::is_expanded(const row_info & info) const
+{
+    auto it = expanded_rows.find(child_path(info));
+    if (it != expanded_rows.end())
+        return it->second;
+    return project->zoom < ZoomMonths;
+}
+bool NamesGraphicsScene::toggle_row(int row_id)
+{
+    if (row_id < 0 || row_id >= (int)rows_info_.size() || ! rows_info_[row_id].task->is_recursive())
+        return false;
+    expanded_rows[child_path(rows_info_[row_id])] = ! is_expanded(rows_info_[row_id]);
+    return true;
+}
 void NamesGraphicsScene::update_selected_row(int row_id, int total_height)
 {
-    if (selection_rect) {
-        this->removeItem(selection_rect);
-        selection_rect = nullptr;
-    }
+    if ( ! selection_rect)
+        return;
 
-    if (row_id >= 0 && row_id < (int)rows_info_.size())
-        selection_rect = this->addRect(0, total_height-rows_info_[row_id].height, this->views()[0]->viewport()->width()-1, rows_info_[row_id].height, QPen(QColor(0,0,0,55)),QBrush(QColor(0,0,0,55)));
+    bool visible = row_id >= 0 && row_id < (int)rows_info_.size();
+    if (visible)
+        selection_rect->setRect(0, total_height-rows_info_[row_id].height, viewport_size(*this).width()-1, rows_info_[row_id].height);
+    selection_rect->setVisible(visible);
 }
 
 template<typename T>
@@ -214,220 +327,281 @@ std::vector<T> operator+(const std::vector<T> & v, const T & t)
     return v2;
 }
 
-void DatesGraphicsScene::redraw()
+// first instant of the column t falls in
+static QDateTime column_floor(const QDateTime & t, int zoom)
+{
+    QDate day = t.date();
+    switch (zoom)
+    {
+        case ZoomHours   : return QDateTime(day, QTime(t.time().hour(), 0, 0));
+        case ZoomWeeks   : return QDateTime(day.addDays(1 - day.dayOfWeek()), QTime(0,0,0));
+        case ZoomMonths  : return QDateTime(QDate(day.year(), day.month(), 1), QTime(0,0,0));
+        case ZoomQuarters: return QDateTime(QDate(day.year(), (day.month()-1)/3*3 + 1, 1), QTime(0,0,0));
+        case ZoomYears   : return QDateTime(QDate(day.year(), 1, 1), QTime(0,0,0));
+        default          : return QDateTime(day, QTime(0,0,0));
+    }
+}
+static QDateTime column_next(const QDateTime & column, int zoom)
+{
+    switch (zoom)
+    {
+        case ZoomHours   : return column.addSecs(3600);
+        case ZoomWeeks   : return column.addDays(7);
+        case ZoomMonths  : return column.addMonths(1);
+        case ZoomQuarters: return column.addMonths(3);
+        case ZoomYears   : return column.addYears(1);
+        default          : return column.addDays(1);
+    }
+}
+static QString column_label(const QDateTime & column, int zoom)
+{
+    switch (zoom)
+    {
+        case ZoomHours   : return column.toString("MM-dd HH:mm");
+        case ZoomWeeks   :
+        {
+            int year;
+            int week = column.date().weekNumber(&year);
+            return QString("%1-W%2").arg(year).arg(week, 2, 10, QChar('0'));
+        }
+        case ZoomMonths  : return column.toString("yyyy-MM");
+        case ZoomQuarters: return QString("%1-Q%2").arg(column.date().year()).arg((column.date().month()-1)/3 + 1);
+        case ZoomYears   : return column.toString("yyyy");
+        default          : return column.toString("yyyy-MM-dd");
+    }
+}
+
+void DatesGraphicsScene::clear_columns()
 {
     clear();
     invalidate(0,0,width(),height());
     setSceneRect(0,0,1,1);
     col_widths_.clear();
+    col_x_     .clear();
+    col_times_ .clear();
+    col_labels_.clear();
+    col_lines_ .clear();
+}
+
+QGraphicsTextItem * DatesGraphicsScene::add_column_label(nixtime column)
+{
+    QGraphicsTextItem * item = this->addText(column_label(QDateTime::fromSecsSinceEpoch(column), col_zoom_));
+    item->setRotation(270.0);
+    return item;
+}
+
+QGraphicsLineItem * DatesGraphicsScene::add_column_line()
+{
+    return this->addLine(QLineF(), QPen(QColor(200,200,200,255)));
+}
+
+void DatesGraphicsScene::remove_column(size_t idx, size_t line_idx)
+{
+    delete col_labels_[idx];
+    delete col_lines_[line_idx];
+    col_labels_.erase(col_labels_.begin() + idx);
+    col_widths_.erase(col_widths_.begin() + idx);
+    col_lines_ .erase(col_lines_ .begin() + line_idx);
+}
 
+void DatesGraphicsScene::redraw()
+{
     if (project->tasks.empty())
+    {
+        clear_columns();
         return;
+    }
 
-    qreal total_width(0);
+    int zoom = project->zoom;
+    nixtime first = column_floor(QDateTime::fromSecsSinceEpoch(project->get_unixtime_earliest()), zoom).toSecsSinceEpoch();
+    nixtime end   = project->get_unixtime_latest();
 
-    QDateTime earliest_datetime = QDateTime::fromSecsSinceEpoch(project->get_unixtime_earliest());
-    QDateTime      end_datetime = QDateTime::fromSecsSinceEpoch(project->get_unixtime_latest());
+    // one column per unit of the zoom level, a new zoom or a range that
+    // does not overlap starts over
+    bool changed = false;
+    if (zoom != col_zoom_ || col_times_.empty() || first >= col_times_.back() || end < col_times_.front())
+    {
+        clear_columns();
+        col_zoom_ = zoom;
+        col_times_.push_back(first);
+        col_lines_.push_back(add_column_line());
+        changed = true;
+    }
 
-    if (project->zoom == 2)
+    // left edge
+    while (col_times_.front() > first)
     {
-        for (auto day = earliest_datetime.date() ; day <= end_datetime.date() ; day = day.addDays(1))
-        {
-            QGraphicsTextItem * item = this->addText(day.toString("yyyy-MM-dd"));
-            item->setRotation(270.0);
-            item->setPos(total_width, this->views()[0]->viewport()->height());
+        nixtime column = column_floor(QDateTime::fromSecsSinceEpoch(col_times_.front() - 1), zoom).toSecsSinceEpoch();
+        QGraphicsTextItem * label = add_column_label(column);
+        col_times_ .insert(col_times_ .begin(), column);
+        col_labels_.insert(col_labels_.begin(), label);
+        col_widths_.insert(col_widths_.begin(), label->boundingRect().height());
+        col_lines_ .insert(col_lines_ .begin(), add_column_line());
+        changed = true;
+    }
+    while (col_times_.size() > 1 && col_times_.front() < first)
+    {
+        remove_column(0, 0);
+        col_times_.erase(col_times_.begin());
+        changed = true;
+    }
 
-            col_widths_.push_back(item->boundingRect().height());
-            total_width += item->boundingRect().height();
-        }
+    // right edge
+    while (col_times_.back() <= end)
+    {
+        QGraphicsTextItem * label = add_column_label(col_times_.back());
+        col_times_ .push_back(column_next(QDateTime::fromSecsSinceEpoch(col_times_.back()), zoom).toSecsSinceEpoch());
+        col_labels_.push_back(label);
+        col_widths_.push_back(label->boundingRect().height());
+        col_lines_ .push_back(add_column_line());
+        changed = true;
     }
-    else if (project->zoom == 1)
+    while (col_times_.size() > 2 && col_times_[col_times_.size()-2] > end)
     {
-        QDateTime hour(earliest_datetime.date(), QTime(earliest_datetime.time().hour(), 0, 0));
-        QDateTime latest_hour(end_datetime.date(), QTime(end_datetime.time().hour(), 0, 0));
-        for ( ; hour <= latest_hour ; hour = hour.addSecs(3600))
-        {
-            QGraphicsTextItem * item = this->addText(hour.toString("MM-dd HH:mm"));
-            item->setRotation(270.0);
-            item->setPos(total_width, this->views()[0]->viewport()->height());
+        remove_column(col_labels_.size()-1, col_lines_.size()-1);
+        col_times_.pop_back();
+        changed = true;
+    }
 
-            col_widths_.push_back(item->boundingRect().height());
-            total_width += item->boundingRect().height();
-        }
+    // labels stand on the bottom, without a view the header fits the longest
+    int bottom = viewport_size(*this).height();
+    if (views().empty())
+    {
+        bottom = 1;
+        for (QGraphicsTextItem * label : col_labels_)
+            bottom = std::max(bottom, (int)std::ceil(label->boundingRect().width()) + 1);
     }
+    if ( ! changed && bottom == col_bottom_)
+        return;
+    col_bottom_ = bottom;
 
+    int total_width = 0;
+    col_x_.resize(col_times_.size());
+    for (size_t i=0 ; i<col_times_.size() ; i++)
     {
-        // vertical lines
-        int height = this->views()[0]->viewport()->height() - 1;
-        setSceneRect(0, 0, total_width, height);
-        int total_width = 0;
-        for (const auto & width : column_widths())
+        col_x_[i] = total_width;
+        col_lines_[i]->setLine(total_width, 0, total_width, bottom - 1);
+        if (i < col_labels_.size())
         {
-            this->addLine(total_width, 0, total_width, height, QPen(QColor(200,200,200,255)));
-            total_width += width;
+            col_labels_[i]->setPos(total_width, bottom);
+            total_width += col_widths_[i];
         }
-        this->addLine(total_width, 0, total_width, height, QPen(QColor(200,200,200,255)));
     }
+    setSceneRect(0, 0, total_width, bottom - 1);
 }
 
-std::uint32_t GanttGraphicsScene::get_pixel_coord(nixtime t) const
+int DatesGraphicsScene::pixel_of(nixtime t) const
 {
-    QDateTime project_begin_date;
-    project_begin_date.setSecsSinceEpoch(project->get_unixtime_earliest());
-
-    QDateTime task_begin;
-    task_begin.setSecsSinceEpoch(t);
-
-    if (project->zoom == 2)
-    {
-        int begin_day_idx = project_begin_date.daysTo(task_begin);
-
-        return std::accumulate(dates_scene.column_widths().begin(), dates_scene.column_widths().begin()+begin_day_idx, 0)
-               + dates_scene.column_widths()[begin_day_idx] * QDateTime(task_begin.date(), QTime(0,0,0)).secsTo(task_begin) / 86400
-             ;
-    }
-    else if (project->zoom == 1)
-    {
-        int begin_day_idx = project_begin_date.secsTo(task_begin) / 3600;
+    if (col_widths_.empty())
+        return 0;
+
+    size_t idx = std::upper_bound(col_times_.begin(), col_times_.end(), t) - col_times_.begin();
+    idx = std::clamp<size_t>(idx, 1, col_widths_.size()) - 1;
+    nixtime_diff offset = (nixtime_diff)t - (nixtime_diff)col_times_[idx];
+    offset = std::clamp<nixtime_diff>(offset, 0, col_times_[idx+1] - col_times_[idx]);
+    return col_x_[idx] + col_widths_[idx] * offset / (nixtime_diff)(col_times_[idx+1] - col_times_[idx]);
+}
 
-        return std::accumulate(dates_scene.column_widths().begin(), dates_scene.column_widths().begin()+begin_day_idx, 0)
-              + dates_scene.column_widths()[begin_day_idx] * QDateTime(task_begin.date(), QTime(task_begin.time().hour(),0,0)).secsTo(task_begin) / 3600
-            ;
-    }
-    return 0;
+std::uint32_t GanttGraphicsScene::get_pixel_coord(nixtime t) const
+{
+    return dates_scene.pixel_of(t);
 }
 
 std::tuple<std::uint32_t,std::uint32_t> GanttGraphicsScene::get_bar_pixel_coords(const row_info & info) const
 {
-    QDateTime project_begin_date;
-    project_begin_date.setSecsSinceEpoch(project->get_unixtime_earliest());
-
-    QDateTime task_begin;
-    QDateTime task_end;
-    task_begin.setSecsSinceEpoch(info.unixime_start);
-    task_end  .setSecsSinceEpoch(info.unixime_end  );
-
-    if (project->zoom == 2)
-    {
-        int begin_day_idx = project_begin_date.daysTo(task_begin);
-        int   end_day_idx = project_begin_date.daysTo(task_end);
-
-        return {  std::accumulate(dates_scene.column_widths().begin(), dates_scene.column_widths().begin()+begin_day_idx, 0)
-                 + dates_scene.column_widths()[begin_day_idx] * QDateTime(task_begin.date(), QTime(0,0,0)).secsTo(task_begin) / 86400
-               , std::accumulate(dates_scene.column_widths().begin(), dates_scene.column_widths().begin()+end_day_idx, 0)
-                 + dates_scene.column_widths()[end_day_idx] * QDateTime(task_end.date(), QTime(0,0,0)).secsTo(task_end) / 86400
-               };
-    }
-    else if (project->zoom == 1)
-    {
-        int begin_day_idx = project_begin_date.secsTo(task_begin) / 3600;
-        int   end_day_idx = project_begin_date.secsTo(task_end) / 3600;
-
-        return {  std::accumulate(dates_scene.column_widths().begin(), dates_scene.column_widths().begin()+begin_day_idx, 0)
-                 + dates_scene.column_widths()[begin_day_idx] * QDateTime(task_begin.date(), QTime(task_begin.time().hour(),0,0)).secsTo(task_begin) / 3600
-               , std::accumulate(dates_scene.column_widths().begin(), dates_scene.column_widths().begin()+end_day_idx, 0)
-                 + dates_scene.column_widths()[end_day_idx] * QDateTime(task_end.date(), QTime(task_end.time().hour(),0,0)).secsTo(task_end) / 3600
-               };
-    }
-    return {};
+    return {dates_scene.pixel_of(info.unixime_start), dates_scene.pixel_of(info.unixime_end)};
 }
 
 void GanttGraphicsScene::redraw_vlines()
 {
     redraw();
 }
-void GanttGraphicsScene::rotate_45(QGraphicsRectItem * item)
+void GanttBarsItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget *)
 {
-    QPointF offset = item->sceneBoundingRect().center();
-    QTransform transform;
-    transform.translate(offset.x(),offset.y());
-    transform.rotate(45);
-    transform.translate(-offset.x(),-offset.y());
-    item->setTransform(transform);
-    this->update();
+    if (tiles != nullptr)
+        tiles->paint(*painter, option->exposedRect);
+    else
+        paint_gantt(*painter, *layout, option->exposedRect);
 }
 void GanttGraphicsScene::redraw()
 {
     clear();
     invalidate(0,0,width(),height());
     setSceneRect(0, 0
-                ,std::max(dates_scene.views()[0]->viewport()->width (), (int)dates_scene.width() )
-                ,std::max(names_scene.views()[0]->viewport()->height(), (int)names_scene.height())
+                ,std::max(viewport_size(dates_scene).width (), (int)dates_scene.width() )
+                ,std::max(viewport_size(names_scene).height(), (int)names_scene.height())
                 );
     selection_rect = nullptr;
     drag_path = nullptr;
     highlighted_from = nullptr;
     highlighted_to   = nullptr;
+    highlighted_arrows = nullptr;
+    arrows.clear();
 
     int width = std::max((int)dates_scene.width(), (int)this->width()) - 1;
 
-    // draw grid
-    if (names_scene.rows_info().size() > 0)
-    {
-        //horizontal lines
-        int total_height = 0;
-        for (const auto & row_info : names_scene.rows_info())
-        {
-            this->addLine(0, total_height, width, total_height, QPen(QColor(200,200,200,255)));
+    // everything but the overlays is painted by a single item
+    bars_item = new GanttBarsItem();
+    bars_item->tiles = &tiles;
+    GanttLayout & layout = *bars_item->layout;
+    layout.width  = this->width();
+    layout.height = this->height();
 
-            // gray subtasks
-            if (row_info.project_tree_path.size() > 1)
-                this->addRect(0, total_height, width, row_info.height, QPen(QColor(0,0,0,20)),QBrush(QColor(0,0,0,20)));
+    // rows and bars
+    int total_height = 0;
+    layout.rows.reserve(names_scene.rows_info().size());
+    layout.bars.reserve(names_scene.rows_info().size());
+    for (const row_info & info : names_scene.rows_info())
+    {
+        layout.rows.push_back({total_height, info.height, info.project_tree_path.size() > 1});
 
-            total_height += row_info.height;
+        if (info.task->is_relative() == false)
+        {
+            int pixel_pos = get_pixel_coord(info.unixime_start);
+            layout.bars.push_back({pixel_pos, pixel_pos, info.task->get_id() == 0 ? GanttLayout::ProjectStart : GanttLayout::TimePoint});
         }
-        this->addLine(0, total_height, width, total_height, QPen(QColor(200,200,200,255)));
-    }
-    qreal total_width(0);
-    if (dates_scene.column_widths().size() > 0)
-    {
-        // vertical lines
-        int height = std::max((int)names_scene.height(), (int)this->height()) - 1;
-        for (const auto & width : dates_scene.column_widths())
+        else if (info.collapsed)
         {
-            this->addLine(total_width, 0, total_width, height, QPen(QColor(200,200,200,255)));
-            total_width += width;
+            auto [bar_pixel_begin, bar_pixel_end] = get_bar_pixel_coords(info);
+            layout.bars.push_back({(int)bar_pixel_begin, (int)bar_pixel_end, GanttLayout::Collapsed});
+            // walking the whole subproject only pays off for the overview
+            if (project->zoom >= ZoomMonths)
+            {
+                GanttLayout::Strip strip = density_strip(*info.task->get_child(), info.unixime_start, bar_pixel_begin, bar_pixel_end);
+                strip.row = layout.rows.size() - 1;
+                if (strip.peak > 0)
+                    layout.strips.push_back(std::move(strip));
+            }
+        }
+        else
+        {
+            auto [bar_pixel_begin, bar_pixel_end] = get_bar_pixel_coords(info);
+            layout.bars.push_back({(int)bar_pixel_begin, (int)bar_pixel_end, info.task->is_recursive() ? GanttLayout::SubProject : GanttLayout::Templated});
         }
-        this->addLine(total_width, 0, total_width, height, QPen(QColor(200,200,200,255)));
+        total_height += info.height;
     }
 
-    // for dependency arrows, later
-    // indices should match that of project->tasks
-    std::vector<std::tuple<int,int,int>> bars_coords; // y,x1,x2
-
-    // draw bars
-    qreal total_height(0);
-    for (const row_info & info : names_scene.rows_info())
+    // vertical lines
+    if (dates_scene.column_widths().size() > 0)
     {
-        // project starting point
-        if (info.task->is_relative() == false)
+        int total_width = 0;
+        layout.columns.reserve(dates_scene.column_widths().size() + 1);
+        layout.columns.push_back(0);
+        for (const auto & width : dates_scene.column_widths())
         {
-            auto pixel_pos = get_pixel_coord(info.unixime_start);
-            QGraphicsRectItem * item = this->addRect(pixel_pos-4, total_height+info.height/2 - 4, 8, 8, QPen(QColor(0,0,0,255)), QBrush(QColor(0,0,0,255*(info.task->get_id() == 0))));
-            rotate_45(item);
-            bars_coords.push_back({total_height+info.height/2, pixel_pos, pixel_pos});
-            total_height += info.height;
-            continue;
+            total_width += width;
+            layout.columns.push_back(total_width);
         }
-
-        auto [bar_pixel_begin, bar_pixel_end] = get_bar_pixel_coords(info);
-        [[maybe_unused]] QGraphicsRectItem * item;
-        if (info.task->is_recursive())
-            item = this->addRect(bar_pixel_begin, total_height+info.height/2-2, bar_pixel_end-bar_pixel_begin, 4, QPen(QColor(0,0,0,0)), QBrush(QColor(0,0,0,255)));
-        else
-            item = this->addRect(bar_pixel_begin, total_height+4              , bar_pixel_end-bar_pixel_begin, info.height-8, QPen(QColor(0,0,0,0)), QBrush(QColor(100,149,237,255)));
-        bars_coords.push_back({total_height+info.height/2, bar_pixel_begin, bar_pixel_end});
-        total_height += info.height;
     }
 
-    // dependency arrows
+    // dependency arrows, rows are in the same order as the traversal
     int i=0;
-    QPen normal_pen(QColor(255,0,0,128));
-    normal_pen.setWidth(2);
-    QPen highlight_pen(QColor(100,237,149,255));
-    highlight_pen.setWidth(3);
-    std::function<void(std::vector<std::tuple<TaskID,Project*>>)> draw_arrows;
-    draw_arrows = [&](std::vector<std::tuple<TaskID,Project*>> project_tree_path)
+    auto bar_point = [&](size_t row, bool end)
+        {
+            return QPointF(end ? layout.bars[row].x2 : layout.bars[row].x1, layout.rows[row].top + layout.rows[row].height/2);
+        };
+    std::function<void(std::vector<std::tuple<TaskID,Project*>>)> collect_arrows;
+    collect_arrows = [&](std::vector<std::tuple<TaskID,Project*>> project_tree_path)
         {
             auto [task_id,proj] = project_tree_path.back();
 
@@ -443,53 +617,120 @@ void GanttGraphicsScene::redraw()
                         continue;
                     auto task_idx = std::distance(names_scene.rows_info().begin(), it);
 
-                    QPen & pen = [&]() ->QPen& {
-                            return (proj == highlighted_dependency.proj
-                                && p.first == highlighted_dependency.parent_task_id
-                                && dependency.task_id == highlighted_dependency.child_task_id
-                                ) ? highlight_pen : normal_pen;
-                        }();
-
-                    QGraphicsPathItem * arrow = nullptr;
-                    if (dependency.type == ganttry::DependencyType::BeginAfter)
-                        arrow = this->draw_arrow(QPointF(std::get<2>(bars_coords[i       ]), std::get<0>(bars_coords[i       ]))
-                                                ,QPointF(std::get<1>(bars_coords[task_idx]), std::get<0>(bars_coords[task_idx]))
-                                                ,pen);
-                    else if (dependency.type == ganttry::DependencyType::BeginWith)
-                        arrow = this->draw_arrow(QPointF(std::get<1>(bars_coords[i       ]), std::get<0>(bars_coords[i       ]))
-                                                ,QPointF(std::get<1>(bars_coords[task_idx]), std::get<0>(bars_coords[task_idx]))
-                                                ,pen);
-                    else if (dependency.type == ganttry::DependencyType::EndBefore)
-                        arrow = this->draw_arrow(QPointF(std::get<1>(bars_coords[i       ]), std::get<0>(bars_coords[i       ]))
-                                                ,QPointF(std::get<2>(bars_coords[task_idx]), std::get<0>(bars_coords[task_idx]))
-                                                ,pen);
-                    else if (dependency.type == ganttry::DependencyType::EndWith)
-                        arrow = this->draw_arrow(QPointF(std::get<2>(bars_coords[i       ]), std::get<0>(bars_coords[i       ]))
-                                                ,QPointF(std::get<2>(bars_coords[task_idx]), std::get<0>(bars_coords[task_idx]))
-                                                ,pen);
-                    if (arrow)
-                        arrow->setFlag(QGraphicsItem::GraphicsItemFlag::ItemIsSelectable);
+                    // which ends of the two bars get linked
+                    bool from_end = dependency.type == DependencyType::BeginAfter || dependency.type == DependencyType::EndWith;
+                    bool   to_end = dependency.type == DependencyType::EndBefore  || dependency.type == DependencyType::EndWith;
+                    GanttLayout::Arrow arrow{bar_point(i, from_end), bar_point(task_idx, to_end)};
+
+                    QPainterPath path;
+                    if (arrow_path(arrow.from, arrow.to, layout.width, layout.height, path))
+                    {
+                        arrows.insert({{proj, p.first, dependency.task_id}, layout.arrows.size()});
+                        layout.arrows.push_back(arrow);
+                    }
                 }
                 i++;
-                if (p.second->is_recursive())
-                    draw_arrows(project_tree_path + std::make_tuple(p.second->get_id(), p.second->get_child()));
+                if (p.second->is_recursive() && ! names_scene.rows_info()[i-1].collapsed)
+                    collect_arrows(project_tree_path + std::make_tuple(p.second->get_id(), p.second->get_child()));
             }
         };
-    draw_arrows({{0,project}});
+    collect_arrows({{0,project}});
+    layout.index_arrows();
+    tiles.set_layout(bars_item->layout, project->zoom);
 
+    this->addItem(bars_item);
+    create_overlays();
+    show_highlighted_arrows();
 
     // selection
     if (selected_row_id != -1)
     {
         int total_height = std::accumulate(names_scene.rows_info().begin(), names_scene.rows_info().begin()+selected_row_id, 0, [](int v, const row_info & left){ return v+left.height; });
+        selection_rect->setRect(0, total_height, width, names_scene.rows_info()[selected_row_id].height);
+        selection_rect->setVisible(true);
+    }
+}
 
-        // update selection
-        //if (selection_rect) {
-        //    this->removeItem(selection_rect);
-        //    selection_rect = nullptr;
-        //}
-        selection_rect = this->addRect(0, total_height, width, names_scene.rows_info()[selected_row_id].height, QPen(QColor(0,0,0,55)),QBrush(QColor(0,0,0,55)));
+GanttLayout::Strip GanttGraphicsScene::density_strip(const Project & child, nixtime start, int x1, int x2) const
+{
+    // count of running tasks per pixel, every task covers at least one
+    int size = std::max(x2 - x1, 1);
+    std::vector<int> diff(size + 1, 0);
+    std::function<void(const Project &, nixtime)> collect = [&](const Project & proj, nixtime base_start_time)
+        {
+            for (const auto & p : proj.tasks)
+            {
+                const Task_Base & task = *p.second;
+                nixtime task_start = base_start_time + task.get_unixtime_start_offset();
+                if (task.is_recursive())
+                {
+                    collect(*task.get_child(), task_start);
+                    continue;
+                }
+                if ( ! task.is_relative())
+                    continue;
+                int begin = std::clamp(dates_scene.pixel_of(task_start) - x1, 0, size - 1);
+                int end   = std::clamp(dates_scene.pixel_of(base_start_time + task.get_unixtime_end_offset()) - x1, begin + 1, size);
+                diff[begin]++;
+                diff[end  ]--;
+            }
+        };
+    collect(child, start);
+
+    GanttLayout::Strip strip{0, x1, 0, {}};
+    strip.density.resize(size);
+    int running = 0;
+    for (int i=0 ; i<size ; i++)
+    {
+        running += diff[i];
+        strip.density[i] = std::min(running, 0xffff);
+        strip.peak = std::max(strip.peak, strip.density[i]);
     }
+    return strip;
+}
+
+void GanttGraphicsScene::create_overlays()
+{
+    selection_rect   = this->addRect(QRectF(), QPen(QColor(0,0,0,55)), QBrush(QColor(0,0,0,55)));
+    highlighted_from = this->addRect(QRectF(), QPen(QColor(0,0,0,255)), QBrush(QColor(237,149,100,255)));
+    highlighted_to   = this->addRect(QRectF(), QPen(QColor(0,0,0,255)), QBrush(QColor(237,149,100,255)));
+    QPen pen(QColor(0,0,0,100));
+    pen.setWidth(3);
+    drag_path = this->addPath(QPainterPath(), pen);
+    highlighted_arrows = this->addPath(QPainterPath(), arrow_pen(true));
+
+    for (QGraphicsItem * item : std::initializer_list<QGraphicsItem*>{selection_rect, highlighted_from, highlighted_to, drag_path, highlighted_arrows})
+    {
+        item->setZValue(1);
+        item->setVisible(false);
+    }
+}
+
+bool GanttGraphicsScene::set_highlighted_dependency(DependencyHighlight d)
+{
+    if ( ! (highlighted_dependency != d))
+        return false;
+    highlighted_dependency = d;
+
+    if (highlighted_arrows != nullptr)
+        show_highlighted_arrows();
+    return true;
+}
+
+void GanttGraphicsScene::show_highlighted_arrows()
+{
+    // drawn over the tiles, which keep every arrow plain
+    const GanttLayout & layout = *bars_item->layout;
+    QPainterPath path;
+    auto [begin, end] = arrows.equal_range({highlighted_dependency.proj, highlighted_dependency.parent_task_id, highlighted_dependency.child_task_id});
+    for (auto it = begin ; it != end ; ++it)
+    {
+        QPainterPath arrow;
+        if (arrow_path(layout.arrows[it->second].from, layout.arrows[it->second].to, layout.width, layout.height, arrow))
+            path.addPath(arrow);
+    }
+    highlighted_arrows->setPath(path);
+    highlighted_arrows->setVisible( ! path.isEmpty());
 }
 
 void GanttGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
@@ -518,10 +759,12 @@ void GanttGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
         if (task_1_id == -1)
             return;
         const ganttry::row_info & info = names_scene.rows_info()[task_1_id];
-        if (info.project_tree_path.size() == 1)
+        QRectF rect;
+        if (info.project_tree_path.size() == 1 && highlighted_from && get_highlight_bar_rect(scene_point.y(), rect))
         {
             is_dragging = true;
-            highlighted_from = create_highlight_bar(scene_point.y());
+            highlighted_from->setRect(rect);
+            highlighted_from->setVisible(true);
         }
     }
 }
@@ -533,22 +776,10 @@ void GanttGraphicsScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
 
     is_dragging = false;
 
-    // cleanup arrow and selected bars
-    if (drag_path) {
-        this->removeItem(drag_path);
-        free(drag_path);
-        drag_path = nullptr;
-    }
-    if (highlighted_from) {
-        this->removeItem(highlighted_from);
-        free(highlighted_from);
-        highlighted_from = nullptr;
-    }
-    if (highlighted_to) {
-        this->removeItem(highlighted_to);
-        free(highlighted_to);
-        highlighted_to = nullptr;
-    }
+    // hide arrow and selected bars
+    drag_path       ->setVisible(false);
+    highlighted_from->setVisible(false);
+    highlighted_to  ->setVisible(false);
 
     // get point coords
     QPointF down_pos = mouseEvent->buttonDownScenePos(Qt::MouseButton::RightButton);
@@ -608,6 +839,8 @@ void GanttGraphicsScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
             return {false,DependencyType::BeginAfter};
         }();
 
+    // left to the background scheduler, like every edit from the window
+    ProjectBatch batch(task_up.get_project(), false);
     if (got_action && task_down.add_child_task(dep, task_up) && task_up.add_parent_task(dep, task_down))
     {
         project->changed = true;
@@ -630,19 +863,10 @@ void GanttGraphicsScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
 
     scroll_if_needed(scene_up_pos);
 
-    // remove old highlight and arrow
-    if (highlighted_to) {
-        this->removeItem(highlighted_to);
-        free(highlighted_to);
-        highlighted_to = nullptr;
-    }
-    if (highlighted_from)
-        this->removeItem(highlighted_from);
-    if (drag_path) {
-        this->removeItem(drag_path);
-        free(drag_path);
-        drag_path = nullptr;
-    }
+    // hide old highlight and arrow
+    highlighted_to  ->setVisible(false);
+    highlighted_from->setVisible(false);
+    drag_path       ->setVisible(false);
 
     // guard against creating items over the border that would expande the scene
     if (scene_up_pos.x() < 0 || scene_up_pos.y() < 0)
@@ -670,16 +894,20 @@ void GanttGraphicsScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
         return;
 
     // new highlight
-    highlighted_to = create_highlight_bar(scene_up_pos.y());
-    this->addItem(highlighted_to);
-    this->addItem(highlighted_from); // readd removed origin highlight
+    QRectF rect;
+    if ( ! get_highlight_bar_rect(scene_up_pos.y(), rect))
+        return;
+    highlighted_to->setRect(rect);
+    highlighted_to->setVisible(true);
+    highlighted_from->setVisible(true);
 
-    // draw the drag arrow
-    QPen pen(QColor(0,0,0,100));
-    pen.setWidth(3);
-    QGraphicsPathItem * new_drag_path = draw_arrow(scene_down_pos, scene_up_pos, pen);
-    if (new_drag_path)
-        drag_path = new_drag_path;
+    // the drag arrow
+    QPainterPath path;
+    if (get_arrow_path(scene_down_pos, scene_up_pos, path))
+    {
+        drag_path->setPath(path);
+        drag_path->setVisible(true);
+    }
 }
 
 std::vector<std::string> split(std::string str, std::string delim)
@@ -699,56 +927,22 @@ std::vector<std::string> split(std::string str, std::string delim)
     return result;
 }
 
-QGraphicsRectItem * GanttGraphicsScene::create_highlight_bar(float scene_y)
+bool GanttGraphicsScene::get_highlight_bar_rect(float scene_y, QRectF & rect)
 {
     auto [row_id,total_height] = get_item_id(scene_y);
     if (row_id == -1 || row_id >= (int)names_scene.rows_info().size())
-        return nullptr;
+        return false;
 
     const row_info & info = names_scene.rows_info()[row_id];
     auto [bar_pixel_begin, bar_pixel_end] = get_bar_pixel_coords(info);
 
-    QGraphicsRectItem * result = new QGraphicsRectItem(bar_pixel_begin, total_height-info.height+4, bar_pixel_end-bar_pixel_begin, info.height-8);
-    result->setPen(QPen(QColor(0,0,0,255)));
-    result->setBrush(QBrush(QColor(237,149,100,255)));
-    return result;
+    rect = QRectF(bar_pixel_begin, total_height-info.height+4, bar_pixel_end-bar_pixel_begin, info.height-8);
+    return true;
 }
 
-QGraphicsPathItem * GanttGraphicsScene::draw_arrow(QPointF from, QPointF to, QPen pen)
+bool GanttGraphicsScene::get_arrow_path(QPointF from, QPointF to, QPainterPath & path) const
 {
-    // guard against creating items over the border that would expande the scene
-    if ( to.x() < 3 || to.x() > width ()-3
-       ||to.y() < 3 || to.y() > height()-3)
-    {
-        return nullptr;
-    }
-
-    QPainterPath path(QPointF(from.x(), from.y()));
-    path.lineTo(to.x(), to.y());
-
-    QTransform rotation1 = QTransform().rotate(30);
-    QTransform rotation2 = QTransform().rotate(-30);
-    QVector2D vec1(rotation1.map(QPointF(from.x()-to.x(), from.y()-to.y())));
-    QVector2D vec2(rotation2.map(QPointF(from.x()-to.x(), from.y()-to.y())));
-
-    vec1.normalize();
-    vec1 *= 10.0;
-    vec2.normalize();
-    vec2 *= 10.0;
-
-    if (  to.x()+vec1.x() > 3 && to.x()+vec1.x() < width ()-4
-       && to.y()+vec1.y() > 3 && to.y()+vec1.y() < height()-4)
-    {
-        path.lineTo(to.x()+vec1.x(), to.y()+vec1.y());
-    }
-    if (  to.x()+vec2.x() > 3 && to.x()+vec2.x() < width ()-4
-       && to.y()+vec2.y() > 3 && to.y()+vec2.y() < height()-4)
-    {
-        path.moveTo(to.x(), to.y());
-        path.lineTo(to.x()+vec2.x(), to.y()+vec2.y());
-    }
-
-    return this->addPath(path, pen);
+    return arrow_path(from, to, width(), height(), path);
 }
 
 void GanttGraphicsScene::scroll_if_needed(QPointF scene_up_pos)
@@ -818,18 +1012,17 @@ void GanttGraphicsScene::updateSelection(int row_id)
 
 void GanttGraphicsScene::updateSelection(int row_id, int total_height)
 {
-    // update selection
-    if (selection_rect) {
-        this->removeItem(selection_rect);
-        selection_rect = nullptr;
-    }
-
+    // move the selection
     if (row_id >= (int)names_scene.rows_info().size())
         row_id = -1;
-    else if (row_id >= 0)
+    if (selection_rect)
     {
-        auto sel_width = std::max(this->views()[0]->viewport()->width(), (int)this->width()) - 1;
-        selection_rect = this->addRect(0, total_height-names_scene.rows_info()[row_id].height, sel_width, names_scene.rows_info()[row_id].height, QPen(QColor(0,0,0,55)),QBrush(QColor(0,0,0,55)));
+        if (row_id >= 0)
+        {
+            auto sel_width = std::max(viewport_size(*this).width(), (int)this->width()) - 1;
+            selection_rect->setRect(0, total_height-names_scene.rows_info()[row_id].height, sel_width, names_scene.rows_info()[row_id].height);
+        }
+        selection_rect->setVisible(row_id >= 0);
     }
 
     names_scene.update_selected_row(row_id, total_height);
@@ -1,14 +1,19 @@
 #ifndef GANTTRY_GRAPHICS_HPP
 #define GANTTRY_GRAPHICS_HPP
 
+#include <map>
 #include <memory>
 #include <tuple>
 #include <vector>
 
 #include <QGraphicsScene>
 #include <QGraphicsRectItem>
+#include <QPainterPath>
+#include <QStaticText>
 
 #include "project.hpp"
+#include "gantt_layout.hpp"
+#include "gantt_tiles.hpp"
 
 namespace ganttry
 {
@@ -24,6 +29,7 @@ struct row_info
     std::uint64_t unixime_earliest;
     std::uint64_t unixime_start;
     std::uint64_t unixime_end;
+    bool collapsed = false; // a subproject whose tasks get no rows
 };
 
 struct DependencyHighlight
@@ -41,10 +47,24 @@ inline bool operator!=(const DependencyHighlight & left, const DependencyHighlig
         ;
 }
 
+// The header keeps its columns between redraws: only columns entering or
+// leaving the project's range are added or removed, at the edges, and
+// everything is rebuilt on zoom only.
 class DatesGraphicsScene : public QGraphicsScene
 {
     Project * project;
     std::vector<int> col_widths_;
+    std::vector<int> col_x_;         // left edge of each column, then the right end
+    std::vector<nixtime> col_times_; // start of each column, then the end of the last
+    std::vector<QGraphicsTextItem*> col_labels_;
+    std::vector<QGraphicsLineItem*> col_lines_; // at each entry of col_x_
+    int col_zoom_   = 0;
+    int col_bottom_ = 0; // labels stand on it
+
+    void clear_columns();
+    QGraphicsTextItem * add_column_label(nixtime column);
+    QGraphicsLineItem * add_column_line();
+    void remove_column(size_t idx, size_t line_idx);
 
 public:
     inline DatesGraphicsScene(Project & p)
@@ -53,19 +73,80 @@ public:
 
     void redraw();
     inline const std::vector<int> & column_widths() const { return col_widths_; }
+    // x of a point in time, linear inside its column
+    int pixel_of(nixtime t) const;
     inline void set_project(Project * p) { project = p; }
     virtual void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
 };
 
+// Paints every row's name in one item, only the rows that are exposed.
+class NameLabelsItem : public QGraphicsItem
+{
+public:
+    struct Label
+    {
+        const QStaticText * text;
+        const QFont       * font;
+        QPointF             pos;
+        int                 height;
+        bool                shaded; // inside a subproject
+    };
+
+    std::vector<Label> labels; // top to bottom, with their separators
+    QRectF bounds;
+
+    inline NameLabelsItem() { setFlag(QGraphicsItem::ItemUsesExtendedStyleOption); }
+
+    inline virtual QRectF boundingRect() const override { return bounds; }
+    virtual void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) override;
+};
+
+// Paints the whole gantt layer from its layout, clipped to the exposed rect,
+// through the tile cache when there is one. The layout is shared with the
+// tile worker, so it is never changed once handed over.
+class GanttBarsItem : public QGraphicsItem
+{
+public:
+    std::shared_ptr<GanttLayout> layout = std::make_shared<GanttLayout>();
+    GanttTileCache * tiles = nullptr;
+
+    inline GanttBarsItem() { setFlag(QGraphicsItem::ItemUsesExtendedStyleOption); }
+
+    inline virtual QRectF boundingRect() const override { return QRectF(0, 0, layout->width, layout->height); }
+    virtual void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) override;
+};
+
 class NamesGraphicsScene : public QGraphicsScene
 {
     Q_OBJECT;
 
+    // a pre-shaped row name
+    struct CachedLabel
+    {
+        QStaticText   text;
+        int           height;
+        std::uint64_t used; // last redraw it was used in
+    };
+
     Project * project;
     DatesGraphicsScene & dates_scene;
     GanttGraphicsScene * gantt_scene;
     std::vector<row_info> rows_info_;
-    QGraphicsRectItem * selection_rect = nullptr;
+    QGraphicsRectItem * selection_rect = nullptr; // kept across selection changes
+
+    // by display name and font, the second font is for subtasks; ids
+    // are only valid for the string table they were cached from
+    std::map<std::tuple<StringID,int>,CachedLabel> label_cache;
+    QFont label_fonts[2];
+    std::uint64_t label_strings = 0; // serial of that table
+    std::uint64_t redraw_count = 0;
+
+    // subprojects the user expanded or collapsed, by the path into them;
+    // the others are expanded below month zoom
+    std::map<std::vector<std::tuple<TaskID,Project*>>,bool> expanded_rows;
+
+    const CachedLabel & get_label(StringID name, int depth);
+    std::vector<std::tuple<TaskID,Project*>> child_path(const row_info & info) const;
 
 public:
     inline NamesGraphicsScene(Project & p, DatesGraphicsScene & dates_scene_)
@@ -81,11 +162,19 @@ public:
     void update_selected_row(int row, int total_height);
     inline void set_project(Project * p) { project = p; }
 
+    bool is_expanded(const row_info & info) const;
+    // returns false when the row is not a subproject
+    bool toggle_row(int row_id);
+    inline void forget_expanded_rows() { expanded_rows.clear(); }
+
     virtual void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
     virtual void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
+    virtual void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
 
 signals:
     void newRow();
+    void taskRemoved(Project * project, TaskID id);
+    void rowToggled(int row_id);
 };
 
 class GanttGraphicsScene : public QGraphicsScene
@@ -96,30 +185,39 @@ class GanttGraphicsScene : public QGraphicsScene
     int selected_row_id = -1;
     NamesGraphicsScene & names_scene;
     DatesGraphicsScene & dates_scene;
-    QGraphicsRectItem * selection_rect = nullptr;
 
-    bool is_dragging = false;
+    // overlays, created hidden by redraw and only moved afterwards
+    QGraphicsRectItem * selection_rect = nullptr;
     QGraphicsPathItem * drag_path = nullptr;
     QGraphicsRectItem * highlighted_from = nullptr;
     QGraphicsRectItem * highlighted_to  = nullptr;
+    QGraphicsPathItem * highlighted_arrows = nullptr;
+
+    bool is_dragging = false;
+
+    GanttBarsItem * bars_item = nullptr;
+    GanttTileCache tiles;
 
     DependencyHighlight highlighted_dependency;
+    // arrows in the layout by project, parent and child, for the highlight overlay
+    std::multimap<std::tuple<const Project*,TaskID,TaskID>,size_t> arrows;
+
+    void create_overlays();
+    void show_highlighted_arrows();
 
 public:
     inline GanttGraphicsScene(Project & p, NamesGraphicsScene & names_, DatesGraphicsScene & dates_)
         : project(&p)
         , names_scene(names_)
         , dates_scene(dates_)
+        , tiles([this](QRect rect) { QMetaObject::invokeMethod(this, [this, rect]() { update(rect); }, Qt::QueuedConnection); })
     {
         names_scene.set_gantt_scene(this);
     }
 
-    inline bool set_highlighted_dependency(decltype(highlighted_dependency) d)
-    {
-        bool result = highlighted_dependency != d;
-        highlighted_dependency = d;
-        return result;
-    }
+    bool set_highlighted_dependency(decltype(highlighted_dependency) d);
+    // what the last redraw laid out, for drawing it elsewhere
+    inline std::shared_ptr<const GanttLayout> get_layout() const { return bars_item ? bars_item->layout : nullptr; }
 
     void redraw();
     void redraw_vlines();
@@ -127,20 +225,20 @@ public:
     void updateSelection(int row_id);
     void updateSelection(int row_id, int total_height);
     void scroll_if_needed(QPointF scene_up_pos);
-    QGraphicsPathItem * draw_arrow(QPointF from, QPointF to, QPen pen);
-    QGraphicsRectItem * create_highlight_bar(float scene_y);
+    bool get_arrow_path(QPointF from, QPointF to, QPainterPath & path) const;
+    bool get_highlight_bar_rect(float scene_y, QRectF & rect);
     std::tuple<int,int> get_item_id(int scene_y);
     int get_selected_row_id() const { return selected_row_id; }
     void unselect_row();
     std::uint32_t get_pixel_coord(nixtime t) const;
     std::tuple<std::uint32_t,uint32_t> get_bar_pixel_coords(const row_info & info) const;
+    GanttLayout::Strip density_strip(const Project & child, nixtime start, int x1, int x2) const;
     virtual void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
     virtual void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
     virtual void mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
 
     inline void set_project(Project * p) { project = p; }
-    void rotate_45(QGraphicsRectItem * item);
 
 signals:
     void selectionChanged(int old_row_id, int new_row_id);
@@ -0,0 +1,186 @@
+
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
+#include "leveling.hpp"
+#include "workspace.hpp"
+
+namespace ganttry
+{
+
+nixtime_diff ResourceTimeline::earliest_fit(nixtime_diff from, nixtime_diff duration, float demand) const
+{
+    // a demand above capacity would never fit, let it take the whole resource
+    demand = std::min(demand, capacity);
+
+    nixtime_diff start = from;
+    for (auto it = std::prev(usage.upper_bound(start)) ; it != usage.end() ; ++it)
+    {
+        auto next = std::next(it);
+        if (next == usage.end())
+            break; // last step is always back to zero usage
+        if (it->second + demand > capacity + 1e-6f)
+            start = next->first; // busy, try again after this step
+        else if (next->first >= start + duration)
+            break;
+    }
+    return start;
+}
+
+void ResourceTimeline::reserve(nixtime_diff begin, nixtime_diff end, float demand)
+{
+    if (end <= begin)
+        return;
+
+    auto split = [&](nixtime_diff t)
+        {
+            auto it = std::prev(usage.upper_bound(t));
+            if (it->first != t)
+                usage.emplace_hint(std::next(it), t, it->second);
+        };
+    split(begin);
+    split(end);
+
+    for (auto it = usage.find(begin) ; it->first < end ; ++it)
+        it->second += demand;
+}
+
+LevelingResult level_resources(Project & project)
+{
+    LevelingResult result;
+    Workspace & workspace = project.get_workspace();
+
+    std::map<ResourceID,ResourceTimeline> timelines;
+    for (const auto & r : workspace.get_resources())
+        timelines.emplace(r.first, ResourceTimeline(r.second.capacity));
+
+    // flat copies of what the loop needs
+    std::vector<Task_Base*> tasks;
+    std::map<TaskID,size_t> index;
+    tasks.reserve(project.tasks.size());
+    for (const auto & p : project.tasks)
+    {
+        index[p.first] = tasks.size();
+        tasks.push_back(p.second.get());
+    }
+
+    std::vector<nixtime_diff> durations   (tasks.size(), 0);
+    std::vector<nixtime_diff> starts      (tasks.size(), 0);
+    std::vector<int>          resource_ids(tasks.size(), -1);
+    std::vector<float>        demands     (tasks.size(), 0);
+    std::vector<int>          missing_parents(tasks.size(), 0);
+    std::vector<std::vector<size_t>> children(tasks.size());
+    for (size_t i=0 ; i<tasks.size() ; i++)
+    {
+        Task_Base & task = *tasks[i];
+        if (task.is_relative())
+            durations[i] = task.duration_in_seconds();
+
+        resource_ids[i] = task.get_resource_id();
+        demands[i] = 1;
+        if (task.get_template_id() >= 0)
+        {
+            if (const TaskTemplate * templ = workspace.find_task_template(task.get_template_id()))
+            {
+                if (resource_ids[i] < 0)
+                    resource_ids[i] = templ->resource_id;
+                demands[i] = templ->resource_demand;
+            }
+        }
+
+        for (const Dependency & d : task.get_parent_tasks())
+        {
+            auto it = index.find(d.task_id);
+            if (it == index.end())
+                continue;
+            missing_parents[i]++;
+            children[it->second].push_back(i);
+        }
+    }
+
+    // same rules as Task_Base::recalculate_start_offset, against leveled parents
+    auto base_start = [&](size_t i) -> nixtime_diff
+        {
+            Task_Base & task = *tasks[i];
+            if ( ! task.is_relative())
+                return task.get_unixtime_start_offset();
+
+            nixtime_diff earliest_offset = std::numeric_limits<nixtime_diff>::lowest();
+            nixtime_diff   latest_offset = std::numeric_limits<nixtime_diff>::max();
+            for (const Dependency & d : task.get_parent_tasks())
+            {
+                auto it = index.find(d.task_id);
+                if (it == index.end())
+                    continue;
+                nixtime_diff parent_start = starts[it->second];
+                nixtime_diff parent_end   = starts[it->second] + durations[it->second];
+                if (d.type == DependencyType::BeginAfter)
+                    earliest_offset = std::max(earliest_offset, parent_end);
+                else if (d.type == DependencyType::BeginWith)
+                    earliest_offset = std::max(earliest_offset, parent_start);
+                else if (d.type == DependencyType::EndBefore)
+                    latest_offset = std::min(latest_offset, parent_start - durations[i]);
+                else if (d.type == DependencyType::EndWith)
+                    latest_offset = std::min(latest_offset, parent_end - durations[i]);
+            }
+            if (  earliest_offset == std::numeric_limits<nixtime_diff>::lowest()
+                 && latest_offset == std::numeric_limits<nixtime_diff>::max())
+                return 0;
+            else if (earliest_offset == std::numeric_limits<nixtime_diff>::lowest())
+                return latest_offset;
+            else
+                return earliest_offset;
+        };
+
+    // priority rule: earliest start first, then longest, then id
+    using Candidate = std::tuple<nixtime_diff,nixtime_diff,size_t>; // start,-duration,idx
+    std::priority_queue<Candidate,std::vector<Candidate>,std::greater<Candidate>> eligible;
+    for (size_t i=0 ; i<tasks.size() ; i++)
+        if (missing_parents[i] == 0)
+            eligible.push({base_start(i), -durations[i], i});
+
+    while ( ! eligible.empty())
+    {
+        auto [start, dummy, i] = eligible.top();
+        eligible.pop();
+
+        auto it_timeline = resource_ids[i] < 0 ? timelines.end() : timelines.find(resource_ids[i]);
+        if (it_timeline != timelines.end() && durations[i] > 0)
+        {
+            ResourceTimeline & timeline = it_timeline->second;
+            nixtime_diff leveled_start = timeline.earliest_fit(start, durations[i], demands[i]);
+            timeline.reserve(leveled_start, leveled_start + durations[i], std::min(demands[i], timeline.get_capacity()));
+            result.delays[tasks[i]->get_id()] = leveled_start - start;
+            if (leveled_start != start)
+                result.delayed_count++;
+            start = leveled_start;
+        }
+        else
+            result.delays[tasks[i]->get_id()] = 0;
+        starts[i] = start;
+
+        for (size_t child : children[i])
+            if (--missing_parents[child] == 0)
+                eligible.push({base_start(child), -durations[child], child});
+    }
+
+    return result;
+}
+
+LevelingResult apply_resource_leveling(Project & project)
+{
+    LevelingResult result = level_resources(project);
+
+    // every task moves once, at the end of the batch
+    ProjectBatch batch(project);
+    for (Task_Base * task : project.topological_order())
+    {
+        auto it = result.delays.find(task->get_id());
+        task->set_leveling_delay(it == result.delays.end() ? 0 : it->second);
+    }
+
+    return result;
+}
+
+} // namespace
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "types.hpp"
+#include "project.hpp"
+
+namespace ganttry
+{
+
+// Usage of one resource over time, stored as a step function:
+// the usage at key k holds until the next key.
+class ResourceTimeline
+{
+    float capacity;
+    std::map<nixtime_diff,float> usage;
+
+public:
+    inline ResourceTimeline(float capacity_)
+        : capacity(capacity_)
+    {
+        usage[std::numeric_limits<nixtime_diff>::lowest()] = 0;
+    }
+
+    inline float get_capacity() const { return capacity; }
+
+    nixtime_diff earliest_fit(nixtime_diff from, nixtime_diff duration, float demand) const;
+    void reserve(nixtime_diff begin, nixtime_diff end, float demand);
+};
+
+struct LevelingResult
+{
+    std::map<TaskID,nixtime_diff> delays;
+    size_t delayed_count = 0;
+};
+
+// Serial schedule generation: tasks become eligible once all their parents
+// are placed, and the eligible task that can start first (longest first on
+// ties) is placed at the earliest time its resource has capacity left.
+LevelingResult level_resources(Project & project);
+
+// Clears previous delays, levels and applies the new delays to the project.
+LevelingResult apply_resource_leveling(Project & project);
+
+} // namespace
@@ -1,11 +1,28 @@
 #include "mainwindow.h"
 
+#include <iostream>
+
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    // ganttry --export chart.pdf workspace.gtw [project index]
+    bool exporting = argc >= 4 && QString(argv[1]) == "--export";
+    if (exporting && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen"); // no display needed
+
     QApplication a(argc, argv);
     MainWindow w;
+    if (exporting)
+    {
+        QString error;
+        if ( ! w.export_chart(argv[3], argv[2], argc > 4 ? QString(argv[4]).toInt() : -1, error))
+        {
+            std::cerr << error.toStdString() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     w.show();
     return a.exec();
 }
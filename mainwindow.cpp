@@ -15,6 +15,7 @@
 #include <QJsonArray>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QTimer>
 #include <QMouseEvent>
 #include <QSettings>
@@ -23,6 +24,10 @@
 #include "project.hpp"
 #include "workspace.hpp"
 #include "ganttry_graphics.hpp"
+#include "leveling.hpp"
+#include "simulation.hpp"
+#include "earned_value.hpp"
+#include "chart_export.hpp"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -31,6 +36,10 @@ MainWindow::MainWindow(QWidget *parent)
     , names_scene(workspace->get_current_project(), dates_scene)
     , dates_scene(workspace->get_current_project())
     , gantt_scene(workspace->get_current_project(), names_scene, dates_scene)
+    , costs(*workspace)
+    , template_stats(*workspace)
+    , redraw_scheduler(this, [this](unsigned stages) { flush_redraw(stages); })
+    , scheduler([this]() { QMetaObject::invokeMethod(this, [this]() { schedule_ready(); }, Qt::QueuedConnection); })
 {
     ui->setupUi(this);
     ui->names_view->setScene(&names_scene);
@@ -50,6 +59,8 @@ MainWindow::MainWindow(QWidget *parent)
     QObject::connect(&gantt_scene, SIGNAL(selectionChanged(int,int)), this, SLOT(on_taskSelectionChanged_triggered(int,int)));
     QObject::connect(&gantt_scene, SIGNAL(newDependency()), this, SLOT(on_newDependency_triggered()));
     QObject::connect(&names_scene, SIGNAL(newRow()), this, SLOT(on_newRow_triggered()));
+    QObject::connect(&names_scene, &ganttry::NamesGraphicsScene::taskRemoved, this, &MainWindow::on_taskRemoved_triggered);
+    QObject::connect(&names_scene, SIGNAL(rowToggled(int)), this, SLOT(on_rowToggled_triggered(int)));
 
     QObject::connect(ui->dependencyTableWidget, SIGNAL(currentCellChanged(int,int,int,int)), this, SLOT(on_highlighted_dependency_changed(int,int,int,int)));
 
@@ -57,6 +68,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->names_view->installEventFilter(this);
     ui->dragHWidget->installEventFilter(this);
     ui->dragVWidget->installEventFilter(this);
+    ui->descriptionTextEdit->installEventFilter(this);
 
     QObject::connect(ui->workspaceTreeWidget, &QTreeWidget::customContextMenuRequested, this, &MainWindow::workspaceTreeWidget_menu);
 
@@ -110,6 +122,8 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    if (risk_simulation.joinable())
+        risk_simulation.join();
     delete ui;
 }
 
@@ -134,18 +148,19 @@ bool MainWindow::eventFilter(QObject *object, QEvent *event)
         ui->workspaceTreeWidget->resize(ui->names_view->geometry().width(), ui->zoomSlider->geometry().height() + ui->dates_view->geometry().height());
         ui->workspaceTreeWidget->setMinimumHeight(ui->zoomSlider->geometry().height() + ui->dates_view->geometry().height());
 
-        dates_scene.redraw();
-        names_scene.redraw();
-        gantt_scene.redraw();
+        redraw_scheduler.mark(ganttry::RedrawDates);
     }
     else if (object == ui->names_view && event->type() == QEvent::Resize)
     {
         ui->workspaceTreeWidget->resize(ui->names_view->geometry().width(), ui->zoomSlider->geometry().height() + ui->dates_view->geometry().height());
         ui->workspaceTreeWidget->setMinimumWidth(ui->names_view->geometry().width());
 
-        dates_scene.redraw();
-        names_scene.redraw();
-        gantt_scene.redraw();
+        redraw_scheduler.mark(ganttry::RedrawLayout);
+    }
+    else if (object == ui->descriptionTextEdit && event->type() == QEvent::FocusOut)
+    {
+        // interned once the edit is done, not on every keystroke
+        updateTaskFromInput();
     }
     else if (object == ui->dragVWidget)
     {
@@ -175,11 +190,7 @@ void MainWindow::resizeEvent(QResizeEvent* event)
 {
    QMainWindow::resizeEvent(event);
 
-   QTimer::singleShot(1, [&](){
-       dates_scene.redraw();
-       names_scene.redraw();
-       gantt_scene.redraw();
-   });
+   redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
 }
 
 void MainWindow::refresh_workspace_tree()
@@ -218,12 +229,35 @@ void MainWindow::refresh_workspace_tree()
 
 void MainWindow::on_newRow_triggered()
 {
+    costs.project_changed(workspace->get_current_project());
+    request_schedule();
+
     ui->nameLineEdit->setFocus(Qt::FocusReason::ActiveWindowFocusReason);
     ui->nameLineEdit->selectAll();
 
-    names_scene.redraw();
-    dates_scene.redraw();
-    gantt_scene.redraw();
+    // the new row gets selected right away
+    redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
+    redraw_scheduler.flush();
+}
+void MainWindow::on_taskRemoved_triggered(ganttry::Project * project, ganttry::TaskID id)
+{
+    costs.project_changed(*project);
+
+    for (ganttry::TemplateID template_id : template_stats.task_removed(*project, id))
+        if (template_stats.apply(template_id))
+            costs.template_changed(template_id);
+    request_schedule();
+
+    // right away, the rows still point at the removed task
+    redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
+    redraw_scheduler.flush();
+}
+void MainWindow::on_rowToggled_triggered(int row_id)
+{
+    // rows below the toggled one move, it stays selected
+    redraw_scheduler.mark(ganttry::RedrawLayout);
+    redraw_scheduler.flush();
+    gantt_scene.updateSelection(row_id);
 }
 void MainWindow::on_taskSelectionChanged_triggered(int old_row_id, int new_row_id)
 {
@@ -242,6 +276,8 @@ void MainWindow::on_taskSelectionChanged_triggered(int old_row_id, int new_row_i
         ui->unitsForecastLineEdit->setText("");
         ui->unitsDoneLineEdit->setText("");
         ui->progressBar->setValue(0);
+        ui->costMaterialLabel->setText("");
+        ui->costManpowerLabel->setText("");
         ui->dependencyTableWidget->clearContents();
         ui->dependencyTableWidget->setRowCount(0);
     };
@@ -274,21 +310,30 @@ void MainWindow::on_taskSelectionChanged_triggered(int old_row_id, int new_row_i
                 else
                     return task->duration_in_seconds();
             }();
-        if (ui->zoomSlider->value() == 2)
-            ui->lastsLabel->setText(QString::fromStdString(std::to_string(duration_in_seconds / 86400.0)) + " days");
-        else if (ui->zoomSlider->value() == 1)
+        if (ui->zoomSlider->value() == ganttry::ZoomHours)
             ui->lastsLabel->setText(QString::fromStdString(std::to_string(duration_in_seconds / 3600.0)) + " hours ");
+        else
+            ui->lastsLabel->setText(QString::fromStdString(std::to_string(duration_in_seconds / 86400.0)) + " days");
         ui->          progressBar->       setValue(100.0 * task->get_units_done_count() / task->get_unit_count_forecast());
-        ui->         nameLineEdit->       setText(QString::fromStdString(task->get_name       ()));
-        ui->  descriptionTextEdit->       setText(QString::fromStdString(task->get_description()));
+        ui->         nameLineEdit->       setText(workspace->get_strings().qstring(task->get_name_id()));
+        ui->  descriptionTextEdit->       setText(workspace->get_strings().qstring(task->get_description_id()));
 
+        ganttry::Cost cost = [&]()
+            {
+                if (task->get_id() == 0)
+                    return costs.project_total_cost(*std::get<1>(info.project_tree_path.back()));
+                else
+                    return costs.task_cost(*task);
+            }();
+        ui->costMaterialLabel->setText(QString::number(cost.material, 'f', 2));
+        ui->costManpowerLabel->setText(QString::number(cost.manpower, 'f', 2));
 
         if (is_timepoint)
         {
             // it's a time point
             ui->unitsForecastLineEdit->setText("");
             ui->    unitsDoneLineEdit->setText("");
-            ui->timepointDateTimeEdit->setDateTime(QDateTime::fromSecsSinceEpoch(dynamic_cast<ganttry::Task_TimePoint*>(task)->get_time_point()));
+            ui->timepointDateTimeEdit->setDateTime(QDateTime::fromSecsSinceEpoch(ganttry::task_cast<ganttry::Task_TimePoint>(task)->get_time_point()));
 
             ui->projectWidget->setVisible(true);
             ui->label_43->setVisible(false);
@@ -310,7 +355,7 @@ void MainWindow::on_taskSelectionChanged_triggered(int old_row_id, int new_row_i
         if (is_templated)
         {
             // it's a templated task
-            int idx = ui->templateComboBox->findData(QVariant::fromValue(dynamic_cast<ganttry::Task_Templated*>(task)->get_template_id()));
+            int idx = ui->templateComboBox->findData(QVariant::fromValue(ganttry::task_cast<ganttry::Task_Templated>(task)->get_template_id()));
             ui->templateComboBox->setCurrentIndex(idx);
         }
 
@@ -406,26 +451,37 @@ void MainWindow::updateTaskFromInput()
         units_done = units_forecast;
 
     bool redraw = false
-            || task.get_name               () != ui->nameLineEdit->text().toStdString()
+            || task.get_name() != ui->nameLineEdit->text().toStdString()
             || task.get_unit_count_forecast() != units_forecast
             || task.get_units_done_count   () != units_done
-            || ((dynamic_cast<ganttry::Task_Templated*>(&task) != nullptr) && (dynamic_cast<ganttry::Task_Templated*>(&task)->get_template_id () != ui->templateComboBox->currentData()))
-            || (!task.is_relative() && timepoint != dynamic_cast<ganttry::Task_TimePoint*>(&task)->get_time_point())
+            || ((ganttry::task_cast<ganttry::Task_Templated>(&task) != nullptr) && (ganttry::task_cast<ganttry::Task_Templated>(&task)->get_template_id () != ui->templateComboBox->currentData()))
+            || (!task.is_relative() && timepoint != ganttry::task_cast<ganttry::Task_TimePoint>(&task)->get_time_point())
         ;
 
     bool was_changed = task.get_project().changed;
 
+    // nothing moves here, the background scheduler's result does that
+    ganttry::ProjectBatch batch(task.get_project(), false);
+
     task.set_name               (ui->nameLineEdit->text().toStdString());
     task.set_description        (ui->descriptionTextEdit->toPlainText().toStdString());
     task.set_template_id        (ui->templateComboBox->currentData().toUInt());
     task.set_unit_count_forecast(units_forecast);
     task.set_units_done_count   (units_done);
+    costs.task_changed(task);
+
+    bool learned = false;
+    for (ganttry::TemplateID id : template_stats.task_changed(task))
+        if (template_stats.apply(id))
+        {
+            costs.template_changed(id);
+            learned = true;
+        }
+    if (learned)
+        redraw = true;
 
     if ( ! task.is_relative())
-    {
-        dynamic_cast<ganttry::Task_TimePoint*>(&task)->set_time_point(timepoint);
-        workspace->get_current_project().recalculate_start_offsets();
-    }
+        ganttry::task_cast<ganttry::Task_TimePoint>(&task)->set_time_point(timepoint);
 
     //ui->beginLabel->setText(QDateTime::fromSecsSinceEpoch(task.get_unixtime_start_offset()).toString("yyyy-MM-dd HH:mm"));
     //ui->  endLabel->setText(QDateTime::fromSecsSinceEpoch(task.get_unixtime_end_offset()).toString("yyyy-MM-dd HH:mm"));
@@ -436,12 +492,11 @@ void MainWindow::updateTaskFromInput()
     //ui->progressBar->setValue(100.0 * task.get_units_done_count() / task.get_unit_count_forecast());
 
     if (redraw) {
-        names_scene.redraw();
-        dates_scene.redraw();
-        gantt_scene.redraw();
+        redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
+        request_schedule();
     }
 
-    this->on_taskSelectionChanged_triggered(gantt_scene.get_selected_row_id(), gantt_scene.get_selected_row_id());
+    redraw_scheduler.mark(ganttry::RedrawSelection);
 
     bool is_changed = task.get_project().changed;
     if (is_changed != was_changed)
@@ -461,10 +516,6 @@ void MainWindow::on_unitsDoneLineEdit_editingFinished()
 {
     updateTaskFromInput();
 }
-void MainWindow::on_descriptionTextEdit_textChanged()
-{
-    updateTaskFromInput();
-}
 void MainWindow::on_tempateComboBox_currentIndexChanged(int index)
 {
     updateTaskFromInput();
@@ -476,7 +527,7 @@ void MainWindow::populate_template_combobox()
 
     ui->templateComboBox->clear();
     for (const auto & t : workspace->get_current_project().get_task_templates())
-        ui->templateComboBox->addItem(QString::fromStdString(t.second.name), QVariant::fromValue(t.first));
+        ui->templateComboBox->addItem(QString::fromStdString(t.name), QVariant::fromValue(t.id));
 
     if (gantt_scene.get_selected_row_id() != -1)
     {
@@ -490,12 +541,10 @@ void MainWindow::populate_template_combobox()
 
 void MainWindow::on_newDependency_triggered()
 {
-    names_scene.redraw();
-    dates_scene.redraw();
-    gantt_scene.redraw();
+    request_schedule();
 
     // refill dependency table, too
-    on_taskSelectionChanged_triggered(gantt_scene.get_selected_row_id(), gantt_scene.get_selected_row_id());
+    redraw_scheduler.mark(ganttry::RedrawAll);
 }
 
 void MainWindow::save_workspace()
@@ -532,15 +581,16 @@ void MainWindow::save_workspace()
     out << "    \"name\": \"" << workspace->get_name() << "\", " << std::endl;
     out << "    \"current_project_idx\": " << workspace->get_current_project_idx() << ", " << std::endl;
     out << "    \"next_task_template_id\": " << workspace->get_next_task_template_id() << ", " << std::endl;
+    out << "    \"next_resource_id\": " << workspace->get_next_resource_id() << ", " << std::endl;
     out << "    \"templates\": [" << std::endl;
     for (auto it=workspace->get_task_templates().begin(), end=workspace->get_task_templates().end() ; it!=end ; )
     {
-        ganttry::TemplateID tid = it->first;
-        ganttry::TaskTemplate & templ = it->second;
+        ganttry::TemplateID tid = it->id;
+        ganttry::TaskTemplate & templ = *it;
         out << "        {\"id\": " << tid
             << ", \"name\": \""        << templ.name << "\""
             << ", \"description\": \"" << templ.description << "\""
-            << ", \"units\": \""       << templ.units << "\""
+            << ", \"units\": \""       << workspace->get_strings().get(templ.units) << "\""
             << ", \"default_UDM\": "                    << templ.default_UDM
             << ", \"average_UDM\": "                    << templ.average_UDM
             << ", \"default_material_cost_per_unit\": " << templ.default_material_cost_per_unit
@@ -548,6 +598,23 @@ void MainWindow::save_workspace()
             << ", \"default_manpower_cost_per_unit\": " << templ.default_manpower_cost_per_unit
             << ", \"average_manpower_cost_per_unit\": " << templ.average_manpower_cost_per_unit
             << ", \"use_avg\": " << (templ.use_avg ? "true" : "false")
+            << ", \"resource_id\": "     << templ.resource_id
+            << ", \"resource_demand\": " << templ.resource_demand
+            << "}";
+        it++;
+        if (it!=end)
+            out << ",";
+        out << std::endl;
+    }
+    out << "    ]," << std::endl;
+
+    out << "    \"resources\": [" << std::endl;
+    for (auto it=workspace->get_resources().begin(), end=workspace->get_resources().end() ; it!=end ; )
+    {
+        const ganttry::Resource & resource = it->second;
+        out << "        {\"id\": "        << resource.id
+            << ", \"name\": \""          << resource.name << "\""
+            << ", \"capacity\": "         << resource.capacity
             << "}";
         it++;
         if (it!=end)
@@ -587,7 +654,7 @@ void MainWindow::save_project(ganttry::Project & project)
     }
 
     if (project.name.empty())
-        project.name = "Unnamed project";
+        project.set_name("Unnamed project");
 
     std::ofstream out(project.filename);
     out << "{" << std::endl;
@@ -646,6 +713,11 @@ void MainWindow::on_workspaceActionNew_triggered()
         }
     }
     workspace = std::make_unique<ganttry::Workspace>();
+    schedule_cache.clear();
+    names_scene.forget_expanded_rows();
+    costs.set_workspace(workspace.get());
+    template_stats.set_workspace(workspace.get());
+    request_schedule();
     refresh_workspace_tree();
     populate_template_combobox();
 
@@ -653,11 +725,47 @@ void MainWindow::on_workspaceActionNew_triggered()
     names_scene.set_project(&workspace->get_current_project());
     gantt_scene.set_project(&workspace->get_current_project());
 
-    dates_scene.redraw();
-    names_scene.redraw();
-    gantt_scene.redraw();
+    // rows still point into the old workspace
+    redraw_scheduler.mark(ganttry::RedrawAll);
+    redraw_scheduler.flush();
+}
+
+
+void MainWindow::request_schedule()
+{
+    scheduler.submit(schedule_cache.snapshot(*workspace), ++schedule_generation);
 }
 
+void MainWindow::schedule_ready()
+{
+    auto result = scheduler.take();
+    if (result == nullptr || result->generation != schedule_generation)
+        return; // edited since, a newer one is on its way
+
+    bool was_changed = workspace->get_current_project().changed;
+    ganttry::apply_schedule(*result);
+
+    redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
+    if (workspace->get_current_project().changed != was_changed)
+        refresh_workspace_tree();
+}
+
+void MainWindow::flush_redraw(unsigned stages)
+{
+    if (stages & ganttry::RedrawDates)
+        dates_scene.redraw();
+    if (stages & ganttry::RedrawLayout)
+        names_scene.redraw();
+    if (stages & ganttry::RedrawBars)
+        gantt_scene.redraw();
+    if (stages & ganttry::RedrawSelection)
+    {
+        int row_id = gantt_scene.get_selected_row_id();
+        if (row_id >= (int)names_scene.rows_info().size())
+            row_id = -1;
+        on_taskSelectionChanged_triggered(row_id, row_id);
+    }
+}
 
 void MainWindow::on_workspaceActionSave_triggered()
 {
@@ -702,6 +810,9 @@ void MainWindow::load_workspace(QString filename)
         return;
 
     workspace->reset();
+    names_scene.forget_expanded_rows();
+    costs.clear();
+    template_stats.clear();
 
     QJsonObject doc_obj = QJsonDocument::fromJson(val.toUtf8()).object();
     QString name = doc_obj["name"].toString();
@@ -709,6 +820,7 @@ void MainWindow::load_workspace(QString filename)
     workspace->set_filename(filename.toStdString());
     workspace->set_current_project_idx(doc_obj["current_project_idx"].toInt());
     workspace->set_next_task_template_id(doc_obj["next_task_template_id"].toInt());
+    workspace->set_next_resource_id(doc_obj["next_resource_id"].toInt());
 
     QJsonArray templates = doc_obj.value(QString("templates")).toArray();
     for (int i=0 ; i<templates.size() ; i++)
@@ -716,7 +828,7 @@ void MainWindow::load_workspace(QString filename)
         ganttry::TaskTemplate t{(uint64_t)templates[i].toObject()["id"                            ].toInt()
                                ,          templates[i].toObject()["name"                          ].toString().toStdString()
                                ,          templates[i].toObject()["description"                   ].toString().toStdString()
-                               ,          templates[i].toObject()["units"                         ].toString().toStdString()
+                               ,          workspace->get_strings().intern(templates[i].toObject()["units"].toString().toStdString())
                                ,(float)   templates[i].toObject()["default_UDM"                   ].toDouble()
                                ,(float)   templates[i].toObject()["average_UDM"                   ].toDouble()
                                ,(float)   templates[i].toObject()["default_material_cost_per_unit"].toDouble()
@@ -724,10 +836,22 @@ void MainWindow::load_workspace(QString filename)
                                ,(float)   templates[i].toObject()["default_manpower_cost_per_unit"].toDouble()
                                ,(float)   templates[i].toObject()["average_manpower_cost_per_unit"].toDouble()
                                ,          templates[i].toObject()["use_avg"                       ].toBool()
+                               ,          templates[i].toObject()["resource_id"                   ].toInt(-1)
+                               ,(float)   templates[i].toObject()["resource_demand"               ].toDouble(1)
                                };
         workspace->add_task_template(t);
     }
 
+    QJsonArray resources = doc_obj.value(QString("resources")).toArray();
+    for (int i=0 ; i<resources.size() ; i++)
+    {
+        ganttry::Resource r{(uint64_t)resources[i].toObject()["id"      ].toInt()
+                           ,          resources[i].toObject()["name"    ].toString().toStdString()
+                           ,(float)   resources[i].toObject()["capacity"].toDouble()
+                           };
+        workspace->add_resource(r);
+    }
+
     QJsonArray projects = doc_obj.value(QString("projects")).toArray();
     for (int i=0 ; i<projects.size() ; i++)
     {
@@ -738,7 +862,11 @@ void MainWindow::load_workspace(QString filename)
     for (auto & proj : workspace->get_projects())
         load_project(*proj, QString::fromStdString(proj->filename));
 
+    // the saved averages stand until some progress moves them
+    template_stats.scan();
+
     workspace->set_changed(false);
+    request_schedule();
 
     populate_template_combobox();
     project_changed();
@@ -763,71 +891,83 @@ void MainWindow::load_project(ganttry::Project & project, QString filename)
     project.filename = filename.toStdString();
 
     QJsonObject doc_obj = QJsonDocument::fromJson(val.toUtf8()).object();
-    project.name           = doc_obj.value(QString("name")).toString().toStdString();
+    project.set_name(doc_obj.value(QString("name")).toString().toStdString());
     project.zoom           = doc_obj.value(QString("zoom")).toInt();
     project.next_task_id   = doc_obj.value(QString("next_task_id")).toInt();
 
-    QJsonArray tasks = doc_obj["tasks"].toArray();
-    for (int i=0 ; i<tasks.size() ; i++)
-    {
-        if (tasks[i].toObject().contains("template_id"))
-            project.add_task(
-                std::make_unique<ganttry::Task_Templated>
-                    ( project
-                    , (ganttry::TaskID)tasks[i].toObject()["id"].toInt()
-                    , tasks[i].toObject()["name"].toString().toStdString()
-                    , tasks[i].toObject()["description"].toString().toStdString()
-                    , (float)tasks[i].toObject()["unit_count_forecast"].toDouble()
-                    , (float)tasks[i].toObject()["units_done_count"].toDouble()
-                    , tasks[i].toObject()["template_id"].toInt()
-                    )
-                );
-        else if (tasks[i].toObject().contains("project_filename"))
-        {
-            std::string proj_filename = tasks[i].toObject()["project_filename"].toString().toStdString();
-            ganttry::Project * proj = workspace->get_project_by_filename(proj_filename);
-            if (proj == nullptr)
-                continue;
-            project.add_task(
-                std::make_unique<ganttry::Task_SubProject>
-                    ( project
-                    , (ganttry::TaskID)tasks[i].toObject()["id"].toInt()
-                    , tasks[i].toObject()["name"].toString().toStdString()
-                    , tasks[i].toObject()["description"].toString().toStdString()
-                    , (float)tasks[i].toObject()["unit_count_forecast"].toDouble()
-                    , (float)tasks[i].toObject()["units_done_count"].toDouble()
-                    , *proj
-                    )
-                );
-        }
-        else if (tasks[i].toObject().contains("time_point"))
+    // tasks are placed once, after all of them and their dependencies are in
+    {
+        ganttry::ProjectBatch batch(project);
+
+        QJsonArray tasks = doc_obj["tasks"].toArray();
+        for (int i=0 ; i<tasks.size() ; i++)
         {
-            project.add_task(
-                std::make_unique<ganttry::Task_TimePoint>
-                    ( project
-                    , (ganttry::TaskID)tasks[i].toObject()["id"].toInt()
-                    , tasks[i].toObject()["name"].toString().toStdString()
-                    , tasks[i].toObject()["description"].toString().toStdString()
-                    , tasks[i].toObject()["time_point"].toInt()
-                    )
-                );
+            if (tasks[i].toObject().contains("template_id"))
+            {
+                auto task = project.make_task<ganttry::Task_Templated>
+                        ( project
+                        , (ganttry::TaskID)tasks[i].toObject()["id"].toInt()
+                        , tasks[i].toObject()["name"].toString().toStdString()
+                        , tasks[i].toObject()["description"].toString().toStdString()
+                        , (float)tasks[i].toObject()["unit_count_forecast"].toDouble()
+                        , (float)tasks[i].toObject()["units_done_count"].toDouble()
+                        , tasks[i].toObject()["template_id"].toInt()
+                        );
+                task->set_actual_material_cost((float)tasks[i].toObject()["actual_material_cost"].toDouble());
+                task->set_actual_manpower_cost((float)tasks[i].toObject()["actual_manpower_cost"].toDouble());
+                task->set_progress_time((ganttry::nixtime)tasks[i].toObject()["progress_time"].toDouble());
+                task->set_actual_start((ganttry::nixtime)tasks[i].toObject()["actual_start"].toDouble(), (float)tasks[i].toObject()["actual_start_units"].toDouble());
+                task->set_resource_id(tasks[i].toObject()["resource_id"].toInt(-1));
+                task->set_leveling_delay((ganttry::nixtime_diff)tasks[i].toObject()["leveling_delay"].toDouble());
+                project.add_task(std::move(task));
+            }
+            else if (tasks[i].toObject().contains("project_filename"))
+            {
+                std::string proj_filename = tasks[i].toObject()["project_filename"].toString().toStdString();
+                ganttry::Project * proj = workspace->get_project_by_filename(proj_filename);
+                if (proj == nullptr)
+                    continue;
+                project.add_task(
+                    project.make_task<ganttry::Task_SubProject>
+                        ( project
+                        , (ganttry::TaskID)tasks[i].toObject()["id"].toInt()
+                        , tasks[i].toObject()["name"].toString().toStdString()
+                        , tasks[i].toObject()["description"].toString().toStdString()
+                        , (float)tasks[i].toObject()["unit_count_forecast"].toDouble()
+                        , (float)tasks[i].toObject()["units_done_count"].toDouble()
+                        , *proj
+                        )
+                    );
+            }
+            else if (tasks[i].toObject().contains("time_point"))
+            {
+                project.add_task(
+                    project.make_task<ganttry::Task_TimePoint>
+                        ( project
+                        , (ganttry::TaskID)tasks[i].toObject()["id"].toInt()
+                        , tasks[i].toObject()["name"].toString().toStdString()
+                        , tasks[i].toObject()["description"].toString().toStdString()
+                        , tasks[i].toObject()["time_point"].toInt()
+                        )
+                    );
+            }
         }
-    }
 
-    // fix next_task_id if inconsisten
-    if ( ! project.tasks.empty() && project.next_task_id <= project.tasks.rbegin()->first)
-        project.next_task_id = project.tasks.rbegin()->first + 1;
+        // fix next_task_id if inconsisten
+        if ( ! project.tasks.empty() && project.next_task_id <= project.tasks.rbegin()->first)
+            project.next_task_id = project.tasks.rbegin()->first + 1;
 
-    QJsonArray deps = doc_obj.value(QString("dependencies")).toArray();
-    for (int i=0 ; i<deps.size() ; i++)
-    {
-        ganttry::DependencyType type    = (ganttry::DependencyType) deps[i].toObject()["type"].toInt();
-        auto from = project.tasks.find((ganttry::DependencyType) deps[i].toObject()["from"].toInt());
-        auto to   = project.tasks.find((ganttry::DependencyType) deps[i].toObject()["to"  ].toInt());
-        if (from == project.tasks.end() || to == project.tasks.end())
-            continue;
-        from->second->add_child_task(type, *to->second);
-        to->second->add_parent_task(type, *from->second);
+        QJsonArray deps = doc_obj.value(QString("dependencies")).toArray();
+        for (int i=0 ; i<deps.size() ; i++)
+        {
+            ganttry::DependencyType type    = (ganttry::DependencyType) deps[i].toObject()["type"].toInt();
+            auto from = project.tasks.find((ganttry::DependencyType) deps[i].toObject()["from"].toInt());
+            auto to   = project.tasks.find((ganttry::DependencyType) deps[i].toObject()["to"  ].toInt());
+            if (from == project.tasks.end() || to == project.tasks.end())
+                continue;
+            from->second->add_child_task(type, *to->second);
+            to->second->add_parent_task(type, *from->second);
+        }
     }
 
     project.changed = false;
@@ -840,11 +980,99 @@ void MainWindow::on_workspaceActionTemplates_triggered()
     dialog.setModal(false);
     dialog.exec();
 
+    if ( ! dialog.get_edited_templates().empty())
+    {
+        workspace->task_templates_changed(dialog.get_edited_templates());
+        for (ganttry::TemplateID id : dialog.get_edited_templates())
+            costs.template_changed(id);
+        request_schedule();
+    }
     refresh_workspace_tree();
     populate_template_combobox();
-    dates_scene.redraw();
-    names_scene.redraw();
-    gantt_scene.redraw();
+    redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
+}
+
+void MainWindow::on_workspaceActionRiskSimulation_triggered()
+{
+    if (simulating)
+    {
+        ui->statusbar->showMessage("Risk simulation already running");
+        return;
+    }
+    if (risk_simulation.joinable())
+        risk_simulation.join();
+    simulating = true;
+    ui->statusbar->showMessage("Running risk simulation...");
+
+    // flattened here, the workspace is only touched on the GUI thread; the
+    // string table's serial tells whether another workspace was opened since
+    std::uint64_t strings_serial = workspace->get_strings().get_serial();
+    risk_simulation = std::thread([this, strings_serial, flat = ganttry::FlatSchedule::build(*workspace)]()
+        {
+            ganttry::ThreadPool pool; // thread_pool is not reentrant and stays the GUI's
+            auto result = std::make_shared<ganttry::SimulationResult>(ganttry::simulate_schedule(flat, pool));
+            QMetaObject::invokeMethod(this, [this, result, strings_serial]() { risk_simulation_ready(*result, strings_serial); }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::risk_simulation_ready(const ganttry::SimulationResult & result, std::uint64_t strings_serial)
+{
+    simulating = false;
+    ui->statusbar->clearMessage();
+    if (strings_serial != workspace->get_strings().get_serial())
+        return;
+
+    // projects may have gone while it ran
+    auto still_open = [&](const ganttry::Project * project)
+        {
+            for (const auto & p : workspace->get_projects())
+                if (p.get() == project)
+                    return true;
+            return false;
+        };
+
+    auto format = [](const ganttry::Percentiles & p)
+        {
+            return QDateTime::fromSecsSinceEpoch(p.p50).toString("yyyy-MM-dd") + "   "
+                 + QDateTime::fromSecsSinceEpoch(p.p80).toString("yyyy-MM-dd") + "   "
+                 + QDateTime::fromSecsSinceEpoch(p.p95).toString("yyyy-MM-dd");
+        };
+
+    QString text = QString::number(result.iterations) + " runs, P50 / P80 / P95\n\nProjects\n";
+    for (const auto & project_risk : result.projects)
+        if (still_open(project_risk.project))
+            text += QString::fromStdString(project_risk.project->name) + ":   " + format(project_risk.completion) + "\n";
+    if ( ! result.milestones.empty())
+    {
+        text += "\nWork following milestones\n";
+        for (const auto & milestone_risk : result.milestones)
+        {
+            if ( ! still_open(milestone_risk.project))
+                continue;
+            const ganttry::Task_Base * task = milestone_risk.project->find_task(milestone_risk.task_id);
+            if (task == nullptr)
+                continue;
+            text += QString::fromStdString(milestone_risk.project->name + " / " + task->get_full_display_name()) + ":   " + format(milestone_risk.dependents_end) + "\n";
+        }
+    }
+
+    QMessageBox::information(this, "Risk simulation", text);
+}
+
+void MainWindow::on_workspaceActionExportEarnedValue_triggered()
+{
+    auto filename = QFileDialog::getSaveFileName(this, "Export earned value...", QString("~/") + QString::fromStdString(workspace->get_name()) + ".csv", "CSV Files (*.csv)");
+    if (filename == "")
+        return;
+
+    auto portfolio = ganttry::compute_earned_value(*workspace, QDateTime::currentSecsSinceEpoch());
+    std::ofstream out(filename.toStdString());
+    ganttry::write_csv(out, portfolio);
+
+    const ganttry::Project & project = workspace->get_current_project();
+    for (const auto & series : portfolio)
+        if (series.project == &project)
+            ui->statusbar->showMessage("SPI " + QString::number(series.SPI, 'f', 2) + "   CPI " + QString::number(series.CPI, 'f', 2));
 }
 
 void MainWindow::on_projectActionNew_triggered()
@@ -862,6 +1090,53 @@ void MainWindow::on_projectActionSave_triggered()
 }
 
 
+void MainWindow::on_projectActionLevelResources_triggered()
+{
+    ganttry::Project & project = workspace->get_current_project();
+    ganttry::LevelingResult result = ganttry::apply_resource_leveling(project);
+    ui->statusbar->showMessage(QString::number(result.delayed_count) + " tasks delayed to fit resource capacities");
+    request_schedule();
+
+    refresh_workspace_tree();
+    redraw_scheduler.mark(ganttry::RedrawAll);
+}
+
+void MainWindow::on_projectActionExportChart_triggered()
+{
+    ganttry::Project & project = workspace->get_current_project();
+    auto filename = QFileDialog::getSaveFileName(this, "Export chart...", QString("~/") + QString::fromStdString(project.name) + ".pdf", "Charts (*.pdf *.svg *.png)");
+    if (filename == "")
+        return;
+
+    QString error;
+    if (ganttry::export_chart(project, filename, error))
+        ui->statusbar->showMessage("Chart exported to " + filename);
+    else
+        QMessageBox::warning(this, "Export chart", error);
+}
+
+bool MainWindow::export_chart(const QString & workspace_filename, const QString & filename, int project_idx, QString & error)
+{
+    if ( ! QFileInfo(workspace_filename).isReadable())
+    {
+        error = "Could not read " + workspace_filename;
+        return false;
+    }
+    load_workspace(workspace_filename);
+    if (project_idx == -1)
+        project_idx = workspace->get_current_project_idx();
+    if (project_idx < 0 || project_idx >= (int)workspace->get_projects().size())
+    {
+        error = "No project " + QString::number(project_idx) + " in " + workspace_filename;
+        return false;
+    }
+
+    // the background pass would land after the export
+    ganttry::reschedule_all(*workspace, thread_pool);
+
+    return ganttry::export_chart(*workspace->get_projects()[project_idx], filename, error);
+}
+
 void MainWindow::on_workspaceTreeWidget_itemDoubleClicked(QTreeWidgetItem *item, [[maybe_unused]] int column)
 {
     int idx = item->data(0, Qt::ItemDataRole::UserRole).toInt();
@@ -882,9 +1157,9 @@ void MainWindow::project_changed()
 
     refresh_workspace_tree();
 
-    dates_scene.redraw();
-    names_scene.redraw();
-    gantt_scene.redraw();
+    // rows still point into the previous project
+    redraw_scheduler.mark(ganttry::RedrawAll);
+    redraw_scheduler.flush();
 
     displaying = true;
     ui->zoomSlider->setValue(workspace->get_current_project().zoom);
@@ -906,8 +1181,8 @@ void MainWindow::on_workspaceTreeWidget_itemChanged(QTreeWidgetItem *item, [[may
         workspace->set_name(new_name);
     } else {
         workspace->get_projects()[idx]->changed |= workspace->get_projects()[idx]->name != new_name;
-        workspace->get_projects()[idx]->name = new_name;
-        names_scene.redraw();
+        workspace->get_projects()[idx]->set_name(new_name);
+        redraw_scheduler.mark(ganttry::RedrawLayout);
     }
 
     refresh_workspace_tree();
@@ -918,15 +1193,13 @@ void MainWindow::on_zoomSlider_valueChanged(int value)
     if (displaying)
         return;
 
+    // subprojects collapse by default from months on
+    bool collapse_changed = (workspace->get_current_project().zoom < ganttry::ZoomMonths) != (value < ganttry::ZoomMonths);
     workspace->get_current_project().changed |= workspace->get_current_project().zoom != value;
     workspace->get_current_project().zoom = value;
     refresh_workspace_tree();
 
-    dates_scene.redraw();
-    names_scene.redraw();
-    gantt_scene.redraw();
-
-    this->on_taskSelectionChanged_triggered(gantt_scene.get_selected_row_id(), gantt_scene.get_selected_row_id());
+    redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawSelection | (collapse_changed ? ganttry::RedrawLayout : ganttry::RedrawNone));
 }
 
 void MainWindow::add_open_recent(const QString & pathName)
@@ -975,8 +1248,7 @@ void MainWindow::on_highlighted_dependency_changed(int row, int col, int prev_ro
         }
     }
 
-    if (gantt_scene.set_highlighted_dependency(highlight))
-        gantt_scene.redraw();
+    gantt_scene.set_highlighted_dependency(highlight);
 }
 
 void MainWindow::on_dependencyTableWidget_customContextMenuRequested(const QPoint &pos)
@@ -1003,13 +1275,11 @@ void MainWindow::on_dependencyTableWidget_customContextMenuRequested(const QPoin
 
         parent_task->remove_child_task(child_task_id);
         child_task->remove_parent_task(parent_task_id);
-        child_task->recalculate_start_offset();
+        request_schedule();
 
         ui->dependencyTableWidget->removeRow(item->row());
 
-        dates_scene.redraw();
-        names_scene.redraw();
-        gantt_scene.redraw();
+        redraw_scheduler.mark(ganttry::RedrawDates | ganttry::RedrawLayout);
     }
 }
 
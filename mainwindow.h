@@ -6,9 +6,17 @@
 #include <QGraphicsView>
 #include <QTreeWidgetItem>
 
+#include <thread>
+
 #include "workspace.hpp"
 #include "project.hpp"
 #include "ganttry_graphics.hpp"
+#include "thread_pool.hpp"
+#include "costs.hpp"
+#include "template_stats.hpp"
+#include "schedule_worker.hpp"
+#include "redraw_scheduler.hpp"
+#include "simulation.hpp"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -26,6 +34,10 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // headless, loads the workspace and writes one project's chart;
+    // the current project when project_idx is -1
+    bool export_chart(const QString & workspace_filename, const QString & filename, int project_idx, QString & error);
+
 private:
     bool eventFilter(QObject *object, QEvent *event);
     void resizeEvent(QResizeEvent* event);
@@ -40,12 +52,18 @@ private:
     void project_changed();
     void add_open_recent(const QString & pathName);
     void workspaceTreeWidget_menu(const QPoint & pos);
+    void request_schedule();
+    void schedule_ready();
+    void risk_simulation_ready(const ganttry::SimulationResult & result, std::uint64_t strings_serial);
+    void flush_redraw(unsigned stages);
 
 
 private slots:
 
     void on_taskSelectionChanged_triggered(int old_row_id, int new_row_id);
     void on_newRow_triggered();
+    void on_taskRemoved_triggered(ganttry::Project * project, ganttry::TaskID id);
+    void on_rowToggled_triggered(int row_id);
     void on_newDependency_triggered();
 
     void on_nameLineEdit_editingFinished();
@@ -54,8 +72,6 @@ private slots:
 
     void on_unitsDoneLineEdit_editingFinished();
 
-    void on_descriptionTextEdit_textChanged();
-
     void on_tempateComboBox_currentIndexChanged(int index);
 
     void on_workspaceActionNew_triggered();
@@ -66,12 +82,20 @@ private slots:
 
     void on_workspaceActionTemplates_triggered();
 
+    void on_workspaceActionRiskSimulation_triggered();
+
+    void on_workspaceActionExportEarnedValue_triggered();
+
     void on_workspaceActionLoad_triggered();
 
     void on_workspaceActionSaveAs_triggered();
 
     void on_projectActionSave_triggered();
 
+    void on_projectActionLevelResources_triggered();
+
+    void on_projectActionExportChart_triggered();
+
     void on_workspaceTreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column);
 
     void on_workspaceTreeWidget_itemChanged(QTreeWidgetItem *item, int column);
@@ -90,6 +114,15 @@ private:
     ganttry::NamesGraphicsScene names_scene;
     ganttry::DatesGraphicsScene dates_scene;
     ganttry::GanttGraphicsScene gantt_scene;
+    ganttry::ThreadPool thread_pool;
+    ganttry::CostRollup costs;
+    ganttry::TemplateStatsLearner template_stats;
+    ganttry::RedrawScheduler redraw_scheduler;
     bool displaying = false;
+    ganttry::FlatScheduleCache schedule_cache;
+    std::uint64_t schedule_generation = 0;
+    std::thread risk_simulation; // joined in the destructor
+    bool simulating = false;
+    ganttry::ScheduleWorker scheduler; // last, joins before the rest goes away
 };
 #endif // MAINWINDOW_H
@@ -13,18 +13,45 @@ std::string operator+(std::string left, const std::string & right)
 namespace ganttry
 {
 
+void Task_Base::set_template_id(int v)
+{
+    if (kind == KindTemplated)
+        static_cast<Task_Templated*>(this)->set_template_id(v);
+}
+Task_Templated::Task_Templated( Project & project
+                              , TaskID id
+                              , std::string name
+                              , std::string description
+                              , float unit_count_forecast
+                              , float units_done_count
+                              , int template_id_
+                              )
+    : Task_Base(project, KindTemplated, id, name, description, unit_count_forecast, units_done_count)
+    , template_id(template_id_)
+{
+    project.workspace.add_template_task(this);
+}
+Task_Templated::~Task_Templated()
+{
+    get_project().workspace.remove_template_task(this);
+}
 void Task_Templated::set_template_id(int v)
 {
-    get_project().changed |= template_id != v;
+    if (template_id == v)
+        return;
+    get_project().changed = true;
+    get_project().workspace.remove_template_task(this);
     template_id = v;
+    get_project().workspace.add_template_task(this);
+    invalidate_duration();
+    get_project().tasks_changed();
+    get_project().schedule_inputs_changed();
 }
 float Task_Templated::duration_in_days() const
 {
-    TaskTemplate & templ = get_project().get_task_template(template_id);
-    if (templ.use_avg && templ.average_UDM != 0)
-        return (get_unit_count_forecast() - get_units_done_count()) / templ.average_UDM;
-    else if (templ.default_UDM != 0)
-        return (get_unit_count_forecast() - get_units_done_count()) / templ.default_UDM;
+    float UDM = get_project().workspace.get_task_template_UDM(template_id);
+    if (UDM != 0)
+        return (get_unit_count_forecast() - get_units_done_count()) / UDM;
     else return 1;
 }
 std::string Task_Templated::to_json(TaskID tid) const
@@ -35,25 +62,46 @@ std::string Task_Templated::to_json(TaskID tid) const
        << ", \"description\": \""       << this->get_description() << "\""
        << ", \"unit_count_forecast\": " << this->get_unit_count_forecast()
        << ", \"units_done_count\": "    << this->get_units_done_count()
+       << ", \"actual_material_cost\": " << this->get_actual_material_cost()
+       << ", \"actual_manpower_cost\": " << this->get_actual_manpower_cost()
+       << ", \"progress_time\": "       << this->get_progress_time()
+       << ", \"actual_start\": "        << this->get_actual_start()
+       << ", \"actual_start_units\": "  << this->get_actual_start_units()
        << ", \"template_id\": "         << this->get_template_id()
+       << ", \"resource_id\": "         << this->get_resource_id()
+       << ", \"leveling_delay\": "      << this->get_leveling_delay()
        << "}"
        ;
     return ss.str();
 }
-std::string Task_Templated::get_full_display_name() const
+StringID Task_Templated::get_display_name_id() const
 {
-    auto task_name = get_name();
-    if ( ! task_name.empty())
-        return task_name;
+    if (get_name_id() != 0)
+        return get_name_id();
     else
-        return get_project().workspace.get_task_template(template_id).name;
-    //const std::string & task_template = get_project().workspace.get_task_template(template_id).name;
-    //auto task_name = get_name();
-    //if (task_name != "")
-    //    task_name = " < " + task_name;
-    //return task_template + task_name;
+    {
+        const TaskTemplate * templ = get_project().workspace.find_task_template(template_id);
+        return templ ? templ->name_id : 0;
+    }
 }
 
+Task_SubProject::Task_SubProject( Project & project
+                                , TaskID id
+                                , std::string name
+                                , std::string description
+                                , float unit_count_forecast
+                                , float units_done_count
+                                , Project & p
+                                )
+    : Task_Base(project, KindSubProject, id, name, description, unit_count_forecast, units_done_count)
+    , child(p)
+{
+    project.workspace.add_subproject_task(this);
+}
+Task_SubProject::~Task_SubProject()
+{
+    get_project().workspace.remove_subproject_task(this);
+}
 float Task_SubProject::duration_in_days() const
 {
     return child.duration_in_seconds() / 86400;
@@ -75,15 +123,12 @@ std::string Task_SubProject::to_json(TaskID tid) const
        ;
     return ss.str();
 }
-std::string Task_SubProject::get_full_display_name() const
+StringID Task_SubProject::get_display_name_id() const
 {
-    auto name = get_name();
-    if ( ! name.empty())
-        return name;
+    if (get_name_id() != 0)
+        return get_name_id();
     else
-        return child.name;
-
-    //return get_name() + ((get_name().size())?" < ":"") + child.name + " < " + get_project().name;
+        return child.get_name_id();
 }
 
 std::string Task_TimePoint::to_json(TaskID tid) const
@@ -99,6 +144,7 @@ std::string Task_TimePoint::to_json(TaskID tid) const
 }
 
 Task_Base::Task_Base( Project & project
+                    , TaskKind kind
                     , TaskID id
                     , std::string name
                     , std::string description
@@ -106,54 +152,169 @@ Task_Base::Task_Base( Project & project
                     , float units_done_count
                     )
     : project(project)
+    , kind(kind)
     , id(id)
-    , name(name)
-    , description(description)
+    , name(project.workspace.get_strings().intern(name))
+    , description(project.workspace.get_strings().intern(description))
     , unit_count_forecast(unit_count_forecast)
     , units_done_count(units_done_count)
+    , actual_material_cost(0)
+    , actual_manpower_cost(0)
+    , progress_time(0)
+    , actual_start(0)
+    , actual_start_units(0)
     , unixtime_start_offset(0)
-{}
+    , leveling_delay(0)
+    , resource_id(-1)
+    , cached_duration(0)
+    , has_cached_duration(false)
+    , parent_tasks(&project.arena)
+    , children_tasks(&project.arena)
+{
+    project.tasks_changed();
+    project.schedule_inputs_changed();
+}
+
+Task_Base::~Task_Base()
+{
+    project.tasks_changed();
+    project.schedule_inputs_changed();
+}
+
 
+const std::string & Task_Base::get_name() const
+{
+    return project.workspace.get_strings().get(name);
+}
+const std::string & Task_Base::get_description() const
+{
+    return project.workspace.get_strings().get(description);
+}
+const std::string & Task_Base::get_full_display_name() const
+{
+    return project.workspace.get_strings().get(get_display_name_id());
+}
 
 void Task_Base::set_id(TaskID v)
 {
-    project.changed |= id != v;
+    if (id != v)
+    {
+        project.changed = true;
+        project.schedule_inputs_changed();
+    }
     id = v;
 }
 void Task_Base::set_name(std::string v)
 {
-    project.changed |= name != v;
-    name = v;
+    StringID id = project.workspace.get_strings().intern(v);
+    project.changed |= name != id;
+    name = id;
 }
 void Task_Base::set_description(std::string v)
 {
-    project.changed |= description != v;
-    description = v;
+    StringID id = project.workspace.get_strings().intern(v);
+    project.changed |= description != id;
+    description = id;
 }
 
 void Task_Base::set_unit_count_forecast(float forecast)
 {
-    project.changed |= unit_count_forecast != forecast;
+    if (unit_count_forecast != forecast)
+    {
+        project.changed = true;
+        invalidate_duration();
+        project.tasks_changed();
+        project.schedule_inputs_changed();
+    }
     this->unit_count_forecast = forecast;
     recalculate_start_offset();
     children_recalculate_start_offset();
 }
 void Task_Base::set_units_done_count(float done)
 {
-    project.changed |= units_done_count != done;
+    if (units_done_count != done)
+    {
+        project.changed = true;
+        progress_time = QDateTime::currentSecsSinceEpoch();
+        if (done <= 0)
+            actual_start = 0;
+        else if (actual_start == 0) // also catches files saved before it was kept
+        {
+            actual_start       = progress_time;
+            actual_start_units = done;
+        }
+        invalidate_duration();
+        project.tasks_changed();
+        project.schedule_inputs_changed();
+    }
     this->units_done_count = done;
     recalculate_start_offset();
     children_recalculate_start_offset();
 }
+void Task_Base::set_actual_material_cost(float v)
+{
+    project.changed |= actual_material_cost != v;
+    actual_material_cost = v;
+}
+void Task_Base::set_actual_manpower_cost(float v)
+{
+    project.changed |= actual_manpower_cost != v;
+    actual_manpower_cost = v;
+}
+void Task_Base::set_progress_time(nixtime v)
+{
+    project.changed |= progress_time != v;
+    progress_time = v;
+}
+void Task_Base::set_actual_start(nixtime v, float units)
+{
+    project.changed |= actual_start != v || actual_start_units != units;
+    actual_start       = v;
+    actual_start_units = units;
+}
 void Task_Base::set_unixtime_start_offset(std::uint64_t v)
 {
-    project.changed |= unixtime_start_offset != v;
+    if (unixtime_start_offset != v)
+    {
+        project.changed = true;
+        project.tasks_changed();
+    }
     this->unixtime_start_offset = v;
     children_recalculate_start_offset();
 }
+void Task_Base::set_scheduled_start_offset(nixtime_diff v)
+{
+    if ((nixtime_diff)unixtime_start_offset != v)
+    {
+        project.changed = true;
+        project.tasks_changed();
+    }
+    this->unixtime_start_offset = v;
+}
+
+void Task_Base::set_leveling_delay(nixtime_diff v)
+{
+    if (leveling_delay != v)
+    {
+        project.changed = true;
+        project.schedule_inputs_changed();
+    }
+    leveling_delay = v;
+    recalculate_start_offset();
+}
+void Task_Base::set_resource_id(int v)
+{
+    project.changed |= resource_id != v;
+    resource_id = v;
+}
 
 void Task_Base::children_recalculate_start_offset()
 {
+    if (project.in_batch())
+    {
+        project.batch_moved = true;
+        return;
+    }
     for (const auto & p : children_tasks)
     {
         auto it = project.tasks.find(p.task_id);
@@ -179,6 +340,8 @@ bool Task_Base::add_child_task(DependencyType d, Task_Base & child)
         it_children->type = d;
     }
 
+    if (changed)
+        project.schedule_inputs_changed();
     return changed;
 }
 bool Task_Base::add_parent_task(DependencyType d, Task_Base & parent)
@@ -199,7 +362,10 @@ bool Task_Base::add_parent_task(DependencyType d, Task_Base & parent)
     }
 
     if (changed)
+    {
+        project.schedule_inputs_changed();
         recalculate_start_offset();
+    }
     return changed;
 }
 bool Task_Base::remove_parent_task(TaskID task_id)
@@ -211,6 +377,7 @@ bool Task_Base::remove_parent_task(TaskID task_id)
         {
             this->parent_tasks.erase(it);
             this->project.changed = true;
+            this->project.schedule_inputs_changed();
             return true;
         }
     }
@@ -225,18 +392,24 @@ bool Task_Base::remove_child_task(TaskID task_id)
         {
             this->children_tasks.erase(it);
             this->project.changed = true;
+            this->project.schedule_inputs_changed();
             return true;
         }
     }
     return false;
 }
 
-nixtime_diff Task_Base::duration_in_seconds() const
-{
-    return 86400 * duration_in_days();
-}
 
 void Task_Base::recalculate_start_offset()
+{
+    if (project.in_batch())
+    {
+        project.batch_moved = true;
+        return;
+    }
+    update_start_offset();
+}
+void Task_Base::update_start_offset()
 {
     nixtime_diff earliest_offset = [&]()
         {
@@ -274,11 +447,11 @@ void Task_Base::recalculate_start_offset()
     if (  earliest_offset == std::numeric_limits<nixtime_diff>::lowest()
          && latest_offset == std::numeric_limits<nixtime_diff>::max()
         )
-        set_unixtime_start_offset(0);
+        set_unixtime_start_offset(leveling_delay);
     else if (earliest_offset == std::numeric_limits<nixtime_diff>::lowest())
-        set_unixtime_start_offset(latest_offset);
+        set_unixtime_start_offset(latest_offset + leveling_delay);
     else
-        set_unixtime_start_offset(earliest_offset);
+        set_unixtime_start_offset(earliest_offset + leveling_delay);
 }
 
 bool Task_Base::find_descendent(TaskID id_)
@@ -294,8 +467,97 @@ bool Task_Base::find_descendent(TaskID id_)
 }
 
 TaskTemplate & Project::get_task_template(TemplateID id) { return workspace.get_task_template(id); }
-std::map<uint64_t,TaskTemplate> & Project::get_task_templates() { return workspace.get_task_templates(); }
+std::vector<TaskTemplate> & Project::get_task_templates() { return workspace.get_task_templates(); }
 Workspace & Project::get_workspace() { return workspace; }
+nixtime_diff Project::duration_in_seconds() const
+{
+    if (cached_duration_dirty)
+    {
+        nixtime_diff end_offset = 0;
+        for (auto & task : tasks)
+            end_offset = std::max(end_offset, task.second->get_unixtime_end_offset());
+        cached_duration = end_offset;
+        cached_duration_dirty = false;
+    }
+    return cached_duration;
+}
+void Project::tasks_changed()
+{
+    // computing a project computes those it embeds, so a clean project
+    // only embeds clean ones and the walk stops at the first dirty one
+    std::vector<Project*> pending{this};
+    while ( ! pending.empty())
+    {
+        Project * project = pending.back();
+        pending.pop_back();
+        if (project->cached_duration_dirty)
+            continue;
+        project->cached_duration_dirty = true;
+        if (auto embedders = workspace.find_subproject_tasks(project))
+            for (Task_SubProject * task : *embedders)
+                pending.push_back(&task->get_project());
+    }
+}
+void Project::end_batch(bool settle)
+{
+    if (batch_depth > 1 || ! batch_moved)
+    {
+        --batch_depth;
+        return;
+    }
+    // parents come first, so one pass settles every task; still in the
+    // batch meanwhile, so nothing cascades
+    if (settle)
+        for (Task_Base * task : topological_order())
+            task->update_start_offset();
+    batch_moved = false;
+    --batch_depth;
+}
+void Project::set_name(std::string v)
+{
+    name_id = workspace.get_strings().intern(v);
+    name = std::move(v);
+}
+void Project::schedule_inputs_changed()
+{
+    schedule_revision = workspace.next_schedule_revision();
+}
+
+std::vector<Task_Base*> Project::topological_order() const
+{
+    // Kahn's algorithm over parent_tasks, dangling dependencies are ignored
+    std::map<TaskID,int> in_degree;
+    std::map<TaskID,std::vector<Task_Base*>> children;
+    for (const auto & p : tasks)
+    {
+        int & degree = in_degree[p.first];
+        for (const Dependency & d : p.second->get_parent_tasks())
+            if (tasks.find(d.task_id) != tasks.end())
+            {
+                ++degree;
+                children[d.task_id].push_back(p.second.get());
+            }
+    }
+
+    std::vector<Task_Base*> result;
+    result.reserve(tasks.size());
+    for (const auto & p : tasks)
+        if (in_degree[p.first] == 0)
+            result.push_back(p.second.get());
+    for (size_t i=0 ; i<result.size() ; i++)
+        for (Task_Base * child : children[result[i]->get_id()])
+            if (--in_degree[child->get_id()] == 0)
+                result.push_back(child);
+
+    // tasks caught in a cycle go last, in id order
+    if (result.size() < tasks.size())
+        for (const auto & p : tasks)
+            if (in_degree[p.first] > 0)
+                result.push_back(p.second.get());
+
+    return result;
+}
+
 bool Project::remove_task(TaskID id)
 {
     auto it = tasks.find(id);
@@ -310,15 +572,15 @@ nixtime_diff Task_SubProject::duration_in_seconds() const
     return child.duration_in_seconds();
 }
 
-nixtime_diff Task_TimePoint::get_unixtime_start_offset() const
-{
-    return ((nixtime_diff)time_point) - get_project().get_unixtime_start();
-}
-
 
 void Task_TimePoint::set_time_point(nixtime t)
 {
-    get_project().changed |= (time_point != t);
+    if (time_point != t)
+    {
+        get_project().changed = true;
+        get_project().tasks_changed(); // time points follow the project's start
+        get_project().schedule_inputs_changed();
+    }
     time_point = t;
     this->set_unixtime_start_offset(t - get_project().get_unixtime_start());
 }
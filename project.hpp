@@ -4,8 +4,10 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <variant>
+#include <memory_resource>
 
 #include <QDateTime>
 
@@ -25,6 +27,24 @@ enum DependencyType {
     EndWith,
 };
 
+// Project::zoom, the time span of one column
+enum Zoom : int {
+    ZoomHours    = 1,
+    ZoomDays     = 2,
+    ZoomWeeks    = 3,
+    ZoomMonths   = 4, // and coarser, subprojects are shown collapsed
+    ZoomQuarters = 5,
+    ZoomYears    = 6,
+};
+
+// Task_Base::kind, the hot accessors switch on it instead of calling
+// virtuals and task_cast checks it instead of dynamic_cast
+enum TaskKind : std::uint8_t {
+    KindTimePoint,
+    KindTemplated,
+    KindSubProject,
+};
+
 struct Project;
 class Workspace;
 struct TaskTemplate;
@@ -38,27 +58,41 @@ struct Dependency
 class Task_Base
 {
     Project     & project              ;
+    TaskKind      kind                 ; // never changes
     TaskID        id                   ;
-    std::string   name                 ;
-    std::string   description          ;
+    StringID      name                 ; // in the workspace's string table
+    StringID      description          ;
     float         unit_count_forecast  ;
     float         units_done_count     ;
+    float         actual_material_cost ; // spent so far
+    float         actual_manpower_cost ;
+    nixtime       progress_time        ; // when units_done_count last changed
+    nixtime       actual_start         ; // when units_done_count first became non-zero, 0 before
+    float         actual_start_units   ; // units done at that point
     std::uint64_t unixtime_start_offset;
+    nixtime_diff  leveling_delay       ; // pushed back by resource leveling
+    int           resource_id          ; // overrides the template's, -1 for none
 
-    // dependencies
-    std::vector<Dependency> parent_tasks  ;
-    std::vector<Dependency> children_tasks;
+    // templated tasks only, dropped when the units or the template change
+    mutable nixtime_diff cached_duration    ;
+    mutable bool         has_cached_duration;
+
+    // dependencies, in the project's arena
+    std::pmr::vector<Dependency> parent_tasks  ;
+    std::pmr::vector<Dependency> children_tasks;
 
     // HR
 
 public:
     Task_Base( Project & project
+             , TaskKind kind
              , TaskID id
              , std::string name
              , std::string description
              , float unit_count_forecast
              , float units_done_count
              );
+    virtual ~Task_Base();
 
     inline Task_Base & operator=(const Task_Base & other)
     {
@@ -69,20 +103,39 @@ public:
         this->description         = other.description;
         this->unit_count_forecast = other.unit_count_forecast;
         this->units_done_count    = other.units_done_count;
+        this->actual_material_cost = other.actual_material_cost;
+        this->actual_manpower_cost = other.actual_manpower_cost;
+        this->progress_time       = other.progress_time;
+        this->actual_start        = other.actual_start;
+        this->actual_start_units  = other.actual_start_units;
+        this->leveling_delay      = other.leveling_delay;
+        this->resource_id         = other.resource_id;
         this->parent_tasks        = other.parent_tasks;
         this->children_tasks      = other.children_tasks;
+        this->has_cached_duration = false;
         return *this;
     }
 
     inline auto & get_project              () const { return project              ; }
+    inline auto & get_kind                 () const { return kind                 ; }
     inline auto & get_id                   () const { return id                   ; }
-    inline auto & get_name                 () const { return name                 ; }
-    inline auto & get_description          () const { return description          ; }
+    inline auto & get_name_id              () const { return name                 ; }
+    inline auto & get_description_id       () const { return description          ; }
+    const std::string & get_name       () const;
+    const std::string & get_description() const;
     inline auto & get_unit_count_forecast  () const { return unit_count_forecast  ; }
     inline auto & get_units_done_count     () const { return units_done_count     ; }
-    virtual inline nixtime_diff get_unixtime_start_offset() const { return unixtime_start_offset; }
+    inline auto & get_actual_material_cost () const { return actual_material_cost ; }
+    inline auto & get_actual_manpower_cost () const { return actual_manpower_cost ; }
+    inline auto & get_progress_time        () const { return progress_time        ; }
+    inline auto & get_actual_start         () const { return actual_start         ; }
+    inline auto & get_actual_start_units   () const { return actual_start_units   ; }
+    inline nixtime_diff get_unixtime_start_offset() const; // by kind, defined below
+    inline auto & get_leveling_delay       () const { return leveling_delay       ; }
+    inline auto & get_resource_id          () const { return resource_id          ; }
     inline auto & get_parent_tasks         () const { return parent_tasks         ; }
     inline auto & get_children_tasks       () const { return children_tasks       ; }
+    inline void invalidate_duration() { has_cached_duration = false; }
 
     void set_id         (TaskID      v);
     void set_name       (std::string v);
@@ -90,29 +143,41 @@ public:
 
     void set_unit_count_forecast(float forecast);
     void set_units_done_count(float done);
-    virtual void set_unixtime_start_offset(std::uint64_t v);
+    void set_actual_material_cost(float v);
+    void set_actual_manpower_cost(float v);
+    void set_progress_time(nixtime v);
+    void set_actual_start(nixtime v, float units);
+    void set_unixtime_start_offset(std::uint64_t v);
+    void set_scheduled_start_offset(nixtime_diff v); // computed elsewhere, no cascade
+    void set_leveling_delay(nixtime_diff v);
+    void set_resource_id(int v);
 
     //std::uint64_t unixtime_start() const;
 
-    virtual inline nixtime_diff get_unixtime_end_offset() const { return unixtime_start_offset + duration_in_seconds(); }
-    virtual nixtime_diff duration_in_seconds() const;
+    inline nixtime_diff get_unixtime_end_offset() const;
+    inline nixtime_diff duration_in_seconds() const;
     bool add_child_task(DependencyType d, Task_Base & t);
     bool add_parent_task(DependencyType d, Task_Base & t);
     bool remove_parent_task(TaskID task_id);
     bool remove_child_task (TaskID task_id);
+    // both wait for the end of a ProjectBatch when one is open
     void recalculate_start_offset();
     void children_recalculate_start_offset();
+    void update_start_offset(); // from the parents only, never deferred
     bool find_descendent(TaskID id);
 
-    inline virtual int get_template_id() const { return -1; }
-    inline virtual bool is_recursive() const { return false; }
-    inline virtual bool is_relative() const { return true; }
-    inline virtual Project * get_child() { return nullptr; }
-    virtual void set_template_id(int) {}; // do nothing
-    virtual float duration_in_days() const = 0;
+    inline bool is_recursive() const { return kind == KindSubProject; }
+    inline bool is_relative () const { return kind != KindTimePoint ; }
+    inline int get_template_id() const;
+    inline Project * get_child();
+    inline const Project * get_child() const;
+    void set_template_id(int v); // only for templated tasks
+    inline float duration_in_days() const;
     virtual bool contains(const Project * const proj) const = 0;
     virtual std::string to_json(TaskID tid) const = 0;
-    virtual std::string get_full_display_name() const = 0;
+    // the task's name, or what it stands for when unnamed
+    virtual StringID get_display_name_id() const = 0;
+    const std::string & get_full_display_name() const;
 };
 
 class Task_TimePoint : public Task_Base
@@ -120,27 +185,28 @@ class Task_TimePoint : public Task_Base
     nixtime time_point;
 
 public:
+    static constexpr TaskKind kind_tag = KindTimePoint;
+
     inline Task_TimePoint( Project & project
                   , TaskID id
                   , std::string name
                   , std::string description
                   , std::uint64_t time
                   )
-        : Task_Base(project, id, name, description, 0, 0)
+        : Task_Base(project, KindTimePoint, id, name, description, 0, 0)
         , time_point(time)
     {}
 
-    inline nixtime get_time_point() { return time_point; }
+    inline nixtime get_time_point() const { return time_point; }
     void set_time_point(nixtime t);
 
-    virtual inline float duration_in_days() const override { return 0; }
+    inline float duration_in_days() const { return 0; }
     virtual inline bool contains(const Project * const ) const override { return false; }
     virtual std::string to_json(TaskID tid) const override;
-    virtual inline std::string get_full_display_name() const override { return get_name(); }
+    virtual inline StringID get_display_name_id() const override { return get_name_id(); }
 
-    virtual nixtime_diff get_unixtime_start_offset() const override;
-    virtual inline nixtime_diff get_unixtime_end_offset() const override { return get_unixtime_start_offset(); }
-    inline virtual bool is_relative() const override { return false; }
+    // follows the project's start, which is a time point too
+    inline nixtime_diff get_unixtime_start_offset() const;
 };
 
 class Task_Templated : public Task_Base
@@ -148,30 +214,31 @@ class Task_Templated : public Task_Base
     int template_id;
 
 public:
-    inline Task_Templated( Project & project
-                         , TaskID id
-                         , std::string name
-                         , std::string description
-                         , float unit_count_forecast
-                         , float units_done_count
-                         , int template_id_
-                         )
-        : Task_Base(project, id, name, description, unit_count_forecast, units_done_count)
-        , template_id(template_id_)
-    {}
+    static constexpr TaskKind kind_tag = KindTemplated;
+
+    // listed in the workspace's tasks by template while alive
+    Task_Templated( Project & project
+                  , TaskID id
+                  , std::string name
+                  , std::string description
+                  , float unit_count_forecast
+                  , float units_done_count
+                  , int template_id_
+                  );
+    ~Task_Templated() override;
     inline Task_Templated & operator=(const Task_Templated & other)
     {
         Task_Base::operator=(other);
-        this->template_id = other.template_id;
+        set_template_id(other.template_id);
         return *this;
     }
-    virtual void set_template_id(int v) override;
-    inline virtual int get_template_id() const override { return template_id; }
+    void set_template_id(int v);
+    inline int get_template_id() const { return template_id; }
 
-    virtual float duration_in_days() const override;
+    float duration_in_days() const;
     inline virtual bool contains(const Project * const) const override { return false; }
     virtual std::string to_json(TaskID tid) const override;
-    virtual std::string get_full_display_name() const override;
+    virtual StringID get_display_name_id() const override;
 
 };
 
@@ -180,45 +247,108 @@ class Task_SubProject : public Task_Base
     Project & child;
 
 public:
-    inline Task_SubProject( Project & project
-                          , TaskID id
-                          , std::string name
-                          , std::string description
-                          , float unit_count_forecast
-                          , float units_done_count
-                          , Project & p
-                          )
-        : Task_Base(project, id, name, description, unit_count_forecast, units_done_count)
-        , child(p)
-    {}
-
-    inline virtual bool is_recursive() const override { return true; }
-    inline virtual Project * get_child() override { return &child; }
-    virtual float duration_in_days() const override;
-    virtual nixtime_diff duration_in_seconds() const override;
+    static constexpr TaskKind kind_tag = KindSubProject;
+
+    // listed in the workspace's subproject tasks while alive
+    Task_SubProject( Project & project
+                   , TaskID id
+                   , std::string name
+                   , std::string description
+                   , float unit_count_forecast
+                   , float units_done_count
+                   , Project & p
+                   );
+    ~Task_SubProject() override;
+
+    inline Project * get_child() { return &child; }
+    inline const Project * get_child() const { return &child; }
+    float duration_in_days() const;
+    nixtime_diff duration_in_seconds() const;
     virtual bool contains(const Project * const p) const override;
     virtual std::string to_json(TaskID tid) const override;
-    virtual std::string get_full_display_name() const override;
+    virtual StringID get_display_name_id() const override;
+};
+
+// Downcast checked against the kind, nullptr when it is another one.
+template<typename T>
+inline T * task_cast(Task_Base * task)
+{
+    return task && task->get_kind() == T::kind_tag ? static_cast<T*>(task) : nullptr;
+}
+template<typename T>
+inline const T * task_cast(const Task_Base * task)
+{
+    return task && task->get_kind() == T::kind_tag ? static_cast<const T*>(task) : nullptr;
+}
+
+// Destroys a task and gives its memory back to the arena it came from.
+struct TaskDeleter
+{
+    std::pmr::memory_resource * arena = nullptr;
+    std::uint32_t size  = 0;
+    std::uint32_t align = 0;
+
+    inline void operator()(Task_Base * task) const
+    {
+        task->~Task_Base();
+        arena->deallocate(task, size, align);
+    }
 };
+using TaskPtr = std::unique_ptr<Task_Base,TaskDeleter>;
 
 struct Project
 {
     bool changed = true;
     std::string filename;
 
-    std::string name = "New project";
+    std::string name = "New project"; // set through set_name
+    StringID name_id = 0;
     Workspace & workspace;
-    std::map<TaskID,std::unique_ptr<Task_Base>> tasks;
+    // Tasks, their map nodes and dependency arrays all come from here,
+    // so a project is built and torn down in large chunks instead of one
+    // malloc per piece. Declared before tasks to outlive them.
+    std::pmr::unsynchronized_pool_resource arena;
+    // kept until one of its tasks, or one of the projects it embeds, is
+    // added, removed, moved or changes duration; declared before tasks
+    // for them to mark it when destroyed
+    mutable nixtime_diff cached_duration       = 0;
+    mutable bool         cached_duration_dirty = true;
+    // unique in the workspace, renewed whenever a task is added or removed
+    // or its id, units, template, time point, leveling delay or
+    // dependencies change, but not when it only moves
+    std::uint64_t schedule_revision = 0;
+    std::pmr::map<TaskID,TaskPtr> tasks{&arena};
     int zoom = 2;
     TaskID next_task_id = 1;
+    // open ProjectBatch count, and whether a start offset was held back
+    int  batch_depth = 0;
+    bool batch_moved = false;
 
     inline Project(Workspace & w, nixtime unixtime_start)
         : workspace(w)
     {
-        tasks[0] = std::make_unique<Task_TimePoint>(*this, 0, "Start", "Project beginning", unixtime_start);
+        set_name(name);
+        tasks[0] = make_task<Task_TimePoint>(*this, 0, "Start", "Project beginning", unixtime_start);
+    }
+    Project(const Project &) = delete;
+    Project & operator=(const Project &) = delete;
+
+    template<typename T, typename... Args>
+    inline std::unique_ptr<T,TaskDeleter> make_task(Args &&... args)
+    {
+        void * memory = arena.allocate(sizeof(T), alignof(T));
+        try
+        {
+            return std::unique_ptr<T,TaskDeleter>(new (memory) T(std::forward<Args>(args)...), TaskDeleter{&arena, sizeof(T), alignof(T)});
+        }
+        catch (...)
+        {
+            arena.deallocate(memory, sizeof(T), alignof(T));
+            throw;
+        }
     }
 
-    inline nixtime get_unixtime_start() { return ((ganttry::Task_TimePoint*)(this->tasks[0].get()))->get_time_point(); }
+    inline nixtime get_unixtime_start() const { return ((ganttry::Task_TimePoint*)(this->tasks.at(0).get()))->get_time_point(); }
     inline nixtime get_unixtime_end() { return get_unixtime_start() + duration_in_seconds(); }
 
     inline nixtime get_unixtime_earliest()
@@ -256,7 +386,7 @@ struct Project
 
     inline TaskID add_task(int template_id, std::string name, float unit_count_forecast, float units_done_count)
     {
-        auto [it,b] = tasks.insert({next_task_id , std::make_unique<Task_Templated>(*this, -1, name, "", unit_count_forecast, units_done_count, template_id)});
+        auto [it,b] = tasks.insert({next_task_id , make_task<Task_Templated>(*this, -1, name, "", unit_count_forecast, units_done_count, template_id)});
         if(!b)
             return -1;
         it->second->set_id(it->first);
@@ -266,7 +396,7 @@ struct Project
     }
     inline TaskID add_time_point(std::string name)
     {
-        auto [it,b] = tasks.insert({next_task_id , std::make_unique<Task_TimePoint>(*this, -1, name, "", get_unixtime_end())});
+        auto [it,b] = tasks.insert({next_task_id , make_task<Task_TimePoint>(*this, -1, name, "", get_unixtime_end())});
         if(!b)
             return -1;
         it->second->set_id(it->first);
@@ -280,7 +410,7 @@ struct Project
         if (child.contains(this))
             return -1;
 
-        auto [it,b] = tasks.insert({next_task_id , std::make_unique<Task_SubProject>(*this, -1, "", "", 1, 0, child)});
+        auto [it,b] = tasks.insert({next_task_id , make_task<Task_SubProject>(*this, -1, "", "", 1, 0, child)});
         if(!b)
             return -1;
         it->second->set_id(it->first);
@@ -299,29 +429,119 @@ struct Project
         return false;
     }
 
-    inline void add_task(std::unique_ptr<Task_Base> && t)
+    inline void add_task(TaskPtr && t)
     {
         tasks[t->get_id()] = std::move(t);
     }
 
+    // one pass in topological order
     inline void recalculate_start_offsets()
     {
-        for (auto & p : tasks)
-            p.second->recalculate_start_offset();
+        begin_batch();
+        batch_moved = true;
+        end_batch();
     }
 
-    inline nixtime_diff duration_in_seconds() const
-    {
-        nixtime_diff end_offset = 0;
-        for (auto & task : tasks)
-            end_offset = std::max(end_offset, task.second->get_unixtime_end_offset());
-        return end_offset;
-    }
+    // also interns it, for display without lookups
+    void set_name(std::string v);
+    inline StringID get_name_id() const { return name_id; }
+
+    nixtime_diff duration_in_seconds() const;
+    // drops the cached duration of this project and of those embedding it
+    void tasks_changed();
+    void schedule_inputs_changed();
+
+    std::vector<Task_Base*> topological_order() const;
+
+    inline bool in_batch() const { return batch_depth > 0; }
+    inline void begin_batch() { ++batch_depth; }
+    void end_batch(bool settle = true);
 
     TaskTemplate & get_task_template(TemplateID id);
-    std::map<uint64_t, TaskTemplate> & get_task_templates();
+    std::vector<TaskTemplate> & get_task_templates();
     Workspace & get_workspace();
     bool remove_task(TaskID id);
 };
 
+// Defers start offset propagation in a project while alive, so any
+// number of edits cost one pass in topological order when the outermost
+// batch ends. Tasks of other projects are not moved, as without a batch.
+// Without settle the pass is skipped and the offsets stay as they are
+// until the background scheduler's result sets them.
+class ProjectBatch
+{
+    Project & project;
+    bool settle;
+
+public:
+    inline explicit ProjectBatch(Project & p, bool settle_ = true) : project(p), settle(settle_) { project.begin_batch(); }
+    inline ~ProjectBatch() { project.end_batch(settle); }
+    ProjectBatch(const ProjectBatch &) = delete;
+    ProjectBatch & operator=(const ProjectBatch &) = delete;
+};
+
+// task accessors dispatched by kind, they need the complete types above
+
+inline nixtime_diff Task_TimePoint::get_unixtime_start_offset() const
+{
+    return ((nixtime_diff)time_point) - get_project().get_unixtime_start();
+}
+
+inline nixtime_diff Task_Base::get_unixtime_start_offset() const
+{
+    if (kind == KindTimePoint)
+        return static_cast<const Task_TimePoint*>(this)->get_unixtime_start_offset();
+    return unixtime_start_offset;
+}
+
+inline float Task_Base::duration_in_days() const
+{
+    switch (kind)
+    {
+        case KindTimePoint : return 0;
+        case KindTemplated : return static_cast<const Task_Templated *>(this)->duration_in_days();
+        case KindSubProject: return static_cast<const Task_SubProject*>(this)->duration_in_days();
+    }
+    return 0;
+}
+
+inline nixtime_diff Task_Base::duration_in_seconds() const
+{
+    switch (kind)
+    {
+        case KindTimePoint : return 0;
+        case KindTemplated :
+            if ( ! has_cached_duration)
+            {
+                cached_duration = 86400 * static_cast<const Task_Templated*>(this)->duration_in_days();
+                has_cached_duration = true;
+            }
+            return cached_duration;
+        case KindSubProject: return static_cast<const Task_SubProject*>(this)->duration_in_seconds();
+    }
+    return 0;
+}
+
+inline nixtime_diff Task_Base::get_unixtime_end_offset() const
+{
+    if (kind == KindTimePoint)
+        return static_cast<const Task_TimePoint*>(this)->get_unixtime_start_offset();
+    return unixtime_start_offset + duration_in_seconds();
+}
+
+inline int Task_Base::get_template_id() const
+{
+    return kind == KindTemplated ? static_cast<const Task_Templated*>(this)->get_template_id() : -1;
+}
+
+inline Project * Task_Base::get_child()
+{
+    return kind == KindSubProject ? static_cast<Task_SubProject*>(this)->get_child() : nullptr;
+}
+
+inline const Project * Task_Base::get_child() const
+{
+    return kind == KindSubProject ? static_cast<const Task_SubProject*>(this)->get_child() : nullptr;
+}
+
 } // namespace
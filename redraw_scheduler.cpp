@@ -0,0 +1,28 @@
+
+#include "redraw_scheduler.hpp"
+
+namespace ganttry
+{
+
+void RedrawScheduler::mark(unsigned stages)
+{
+    if (stages & (RedrawDates | RedrawLayout))
+        stages |= RedrawBars;
+    dirty |= stages;
+
+    if (posted || dirty == RedrawNone)
+        return;
+    posted = true;
+    QMetaObject::invokeMethod(context, [this]() { flush(); }, Qt::QueuedConnection);
+}
+
+void RedrawScheduler::flush()
+{
+    posted = false;
+    unsigned stages = dirty;
+    dirty = RedrawNone;
+    if (stages != RedrawNone)
+        flush_stages(stages);
+}
+
+} // namespace
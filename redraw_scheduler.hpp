@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+
+#include <QObject>
+
+namespace ganttry
+{
+
+// Parts of the window that can be rebuilt separately, in flush order.
+// Bars are drawn from the dates' columns and the names' rows, so
+// dirtying either of those dirties the bars too.
+enum RedrawStage : unsigned
+{
+    RedrawNone      = 0,
+    RedrawDates     = 1 << 0, // dates header and column widths
+    RedrawLayout    = 1 << 1, // names and row heights
+    RedrawBars      = 1 << 2, // gantt scene
+    RedrawSelection = 1 << 3, // task panel
+    RedrawAll       = RedrawDates | RedrawLayout | RedrawBars | RedrawSelection,
+};
+
+// Collects dirty stages and flushes them once per event loop pass, so a
+// burst of edits or resize events costs a single rebuild.
+class RedrawScheduler
+{
+    QObject * context;
+    std::function<void(unsigned)> flush_stages;
+    unsigned dirty = RedrawNone;
+    bool posted = false;
+
+public:
+    inline RedrawScheduler(QObject * context_, std::function<void(unsigned)> flush_stages_)
+        : context(context_)
+        , flush_stages(std::move(flush_stages_))
+    {}
+
+    void mark(unsigned stages);
+    // runs the dirty stages now, for callers that need the rows right away
+    void flush();
+    inline unsigned pending() const { return dirty; }
+};
+
+} // namespace
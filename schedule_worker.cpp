@@ -0,0 +1,92 @@
+
+#include "schedule_worker.hpp"
+
+namespace ganttry
+{
+
+ScheduleWorker::ScheduleWorker(std::function<void()> on_published_)
+    : on_published(std::move(on_published_))
+    , thread([this]() { loop(); })
+{}
+
+ScheduleWorker::~ScheduleWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void ScheduleWorker::submit(FlatSchedule::Snapshot snapshot, std::uint64_t generation)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::make_unique<FlatSchedule::Snapshot>(std::move(snapshot));
+        pending_generation = generation;
+    }
+    cv.notify_one();
+}
+
+std::shared_ptr<const ScheduleResult> ScheduleWorker::take()
+{
+    return std::atomic_exchange(&published, std::shared_ptr<const ScheduleResult>());
+}
+
+void ScheduleWorker::loop()
+{
+    for (;;)
+    {
+        std::unique_ptr<FlatSchedule::Snapshot> snapshot;
+        std::uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return stopping || pending; });
+            if (stopping)
+                return;
+            snapshot = std::move(pending);
+            generation = pending_generation;
+        }
+
+        auto result = std::make_shared<ScheduleResult>();
+        result->generation = generation;
+        result->schedule   = FlatSchedule::build(*snapshot);
+        result->state      = result->schedule.make_state();
+        result->schedule.run(result->state, pool);
+
+        {
+            // superseded while running
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending || stopping)
+                continue;
+        }
+        std::atomic_store(&published, std::shared_ptr<const ScheduleResult>(std::move(result)));
+        if (on_published)
+            on_published();
+    }
+}
+
+void apply_schedule(const ScheduleResult & result)
+{
+    const FlatSchedule & schedule = result.schedule;
+    for (const FlatSchedule::FlatProject & project : schedule.projects)
+        for (std::uint32_t i=project.first_task, end=project.first_task+project.task_count ; i<end ; i++)
+        {
+            if (schedule.tasks[i].kind == FlatSchedule::TimePoint)
+                continue;
+            Task_Base * task = project.project->find_task(schedule.tasks[i].id);
+            if (task != nullptr)
+                task->set_scheduled_start_offset(result.state.starts[i]);
+        }
+}
+
+void reschedule_all(Workspace & workspace, ThreadPool & pool)
+{
+    ScheduleResult result{0, FlatSchedule::build(workspace), {}};
+    result.state = result.schedule.make_state();
+    result.schedule.run(result.state, pool);
+    apply_schedule(result);
+}
+
+} // namespace
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "flat_schedule.hpp"
+#include "thread_pool.hpp"
+
+namespace ganttry
+{
+
+struct ScheduleResult
+{
+    std::uint64_t       generation;
+    FlatSchedule        schedule;
+    FlatSchedule::State state;
+};
+
+// Schedules snapshots of the workspace on its own thread, joined into a
+// FlatSchedule there as well. Only the latest submitted snapshot is kept:
+// a newer submit supersedes a pending one, and a pass that finishes after
+// a newer submit is thrown away. Results are published into a single slot
+// that the UI takes from; on_published is called from the worker thread.
+// Independent projects are scheduled on a pool of its own, so passes
+// never wait for the UI's pool.
+class ScheduleWorker
+{
+    ThreadPool pool;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unique_ptr<FlatSchedule::Snapshot> pending;
+    std::uint64_t pending_generation = 0;
+    bool stopping = false;
+
+    std::shared_ptr<const ScheduleResult> published; // atomic access only
+    std::function<void()> on_published;
+    std::thread thread;
+
+    void loop();
+
+public:
+    explicit ScheduleWorker(std::function<void()> on_published);
+    ~ScheduleWorker();
+
+    void submit(FlatSchedule::Snapshot snapshot, std::uint64_t generation);
+    // latest result not taken yet, or null
+    std::shared_ptr<const ScheduleResult> take();
+};
+
+// Writes the computed start offsets back into the tasks. Only valid while
+// the workspace still matches the snapshot, i.e. for the last generation.
+void apply_schedule(const ScheduleResult & result);
+
+// Schedules the whole workspace right away, the projects of an embedding
+// level in parallel, and applies the result.
+void reschedule_all(Workspace & workspace, ThreadPool & pool);
+
+} // namespace
@@ -0,0 +1,169 @@
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+#include "workspace.hpp"
+
+namespace ganttry
+{
+
+namespace
+{
+
+struct Triangular
+{
+    float low;
+    float mode;
+    float high;
+
+    inline float sample(float u) const
+    {
+        if (high <= low)
+            return mode;
+        float c = (mode - low) / (high - low);
+        if (u < c)
+            return low + std::sqrt(u * (high - low) * (mode - low));
+        else
+            return high - std::sqrt((1 - u) * (high - low) * (high - mode));
+    }
+};
+
+Triangular make_distribution(const FlatSchedule::Template & templ, float spread)
+{
+    if (templ.UDM == 0)
+        return {0, 0, 0};
+
+    float low  = templ.UDM;
+    float high = templ.UDM;
+    for (float UDM : {templ.default_UDM, templ.average_UDM})
+        if (UDM != 0)
+        {
+            low  = std::min(low , UDM);
+            high = std::max(high, UDM);
+        }
+    return {low * (1 - spread), templ.UDM, high * (1 + spread)};
+}
+
+Percentiles percentiles(nixtime_diff * begin, nixtime_diff * end, nixtime base)
+{
+    std::sort(begin, end);
+    size_t count = end - begin;
+    auto at = [&](double p) { return base + begin[std::min(count-1, (size_t)std::ceil(p * count) - 1)]; };
+    return {at(0.50), at(0.80), at(0.95)};
+}
+
+} // namespace
+
+SimulationResult simulate_schedule(Workspace & workspace, ThreadPool & pool, const SimulationSettings & settings)
+{
+    return simulate_schedule(FlatSchedule::build(workspace), pool, settings);
+}
+
+SimulationResult simulate_schedule(const FlatSchedule & flat, ThreadPool & pool, const SimulationSettings & settings)
+{
+    SimulationResult result;
+    if (settings.iterations == 0)
+        return result;
+
+    std::vector<Triangular> distributions;
+    distributions.reserve(flat.templates.size());
+    for (const auto & templ : flat.templates)
+        distributions.push_back(make_distribution(templ, settings.UDM_spread));
+
+    // milestones and the tasks hanging from them
+    struct Milestone
+    {
+        size_t project_idx;
+        std::uint32_t task;
+        std::vector<std::uint32_t> dependents;
+    };
+    std::vector<Milestone> milestones;
+    {
+        std::map<std::uint32_t,size_t> milestone_index;
+        for (size_t p=0 ; p<flat.projects.size() ; p++)
+        {
+            const auto & project = flat.projects[p];
+            for (std::uint32_t i=project.first_task, end=project.first_task+project.task_count ; i<end ; i++)
+            {
+                const auto & task = flat.tasks[i];
+                for (std::uint32_t d=task.first_parent, d_end=task.first_parent+task.parent_count ; d<d_end ; d++)
+                {
+                    std::uint32_t parent = flat.dependencies[d].task;
+                    if (flat.tasks[parent].kind != FlatSchedule::TimePoint || flat.tasks[parent].id == 0)
+                        continue;
+                    auto [it,b] = milestone_index.insert({parent, milestones.size()});
+                    if (b)
+                        milestones.push_back({p, parent, {}});
+                    milestones[it->second].dependents.push_back(i);
+                }
+            }
+        }
+    }
+
+    const size_t iterations = settings.iterations;
+    const size_t item_count = flat.projects.size() + milestones.size();
+    std::vector<nixtime_diff> samples(item_count * iterations);
+
+    std::vector<FlatSchedule::State> states(pool.size(), flat.make_state());
+    std::vector<std::mt19937_64> rngs(pool.size());
+
+    pool.parallel_for(iterations, 64, [&](size_t begin, size_t end, size_t worker)
+        {
+            FlatSchedule::State & state = states[worker];
+            std::mt19937_64 & rng = rngs[worker];
+            // seeded by chunk so results don't depend on which worker ran it
+            rng.seed(settings.seed * 0x9E3779B97F4A7C15ull + begin);
+            std::uniform_real_distribution<float> uniform(0, 1);
+
+            for (size_t iteration=begin ; iteration<end ; iteration++)
+            {
+                flat.run(state, [&](std::uint32_t i) -> nixtime_diff
+                    {
+                        const auto & task = flat.tasks[i];
+                        if (task.template_idx < 0)
+                            return flat.templated_duration(task, 0);
+                        return flat.templated_duration(task, distributions[task.template_idx].sample(uniform(rng)));
+                    });
+
+                for (size_t p=0 ; p<flat.projects.size() ; p++)
+                    samples[p * iterations + iteration] = state.project_durations[p];
+                for (size_t m=0 ; m<milestones.size() ; m++)
+                {
+                    nixtime_diff latest = std::numeric_limits<nixtime_diff>::lowest();
+                    for (std::uint32_t i : milestones[m].dependents)
+                        latest = std::max(latest, state.ends[i]);
+                    samples[(flat.projects.size() + m) * iterations + iteration] = latest;
+                }
+            }
+        });
+
+    result.iterations = iterations;
+    result.projects  .resize(flat.projects.size());
+    result.milestones.resize(milestones.size());
+    pool.parallel_for(item_count, 1, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t item=begin ; item<end ; item++)
+            {
+                nixtime_diff * first = samples.data() + item * iterations;
+                if (item < flat.projects.size())
+                {
+                    const auto & project = flat.projects[item];
+                    result.projects[item] = {project.project, percentiles(first, first + iterations, project.unixtime_start)};
+                }
+                else
+                {
+                    const Milestone & milestone = milestones[item - flat.projects.size()];
+                    const auto & project = flat.projects[milestone.project_idx];
+                    result.milestones[item - flat.projects.size()] = {project.project, flat.tasks[milestone.task].id, percentiles(first, first + iterations, project.unixtime_start)};
+                }
+            }
+        });
+
+    return result;
+}
+
+} // namespace
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+#include "project.hpp"
+#include "flat_schedule.hpp"
+
+namespace ganttry
+{
+
+class Workspace;
+class ThreadPool;
+
+struct SimulationSettings
+{
+    size_t        iterations = 10000;
+    std::uint64_t seed       = 0;
+    // widening of the [default_UDM, average_UDM] range each side,
+    // so templates with a single known UDM still vary
+    float         UDM_spread = 0.25f;
+};
+
+struct Percentiles
+{
+    nixtime p50;
+    nixtime p80;
+    nixtime p95;
+};
+
+struct ProjectRisk
+{
+    Project *   project;
+    Percentiles completion;
+};
+
+// Task_TimePoints can't have parents, so their risk is when the work
+// hanging from them is done: the latest end among their dependents.
+struct MilestoneRisk
+{
+    Project *   project;
+    TaskID      task_id;
+    Percentiles dependents_end;
+};
+
+struct SimulationResult
+{
+    size_t iterations = 0;
+    std::vector<ProjectRisk>   projects;
+    std::vector<MilestoneRisk> milestones;
+};
+
+// Samples every templated task's throughput from a triangular distribution
+// around its template's UDMs and reschedules the whole workspace, subprojects
+// included, once per iteration. Iterations are spread over the pool, each
+// worker with its own RNG and schedule state.
+SimulationResult simulate_schedule(Workspace & workspace, ThreadPool & pool, const SimulationSettings & settings = {});
+// same on a schedule flattened beforehand; touches no project, so it can
+// run off the GUI thread, the projects in the result are only identities
+SimulationResult simulate_schedule(const FlatSchedule & flat, ThreadPool & pool, const SimulationSettings & settings = {});
+
+} // namespace
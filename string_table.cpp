@@ -0,0 +1,51 @@
+
+#include <atomic>
+
+#include "string_table.hpp"
+
+namespace ganttry
+{
+
+static std::atomic<std::uint64_t> next_serial{1};
+
+StringTable::StringTable()
+    : serial(next_serial++)
+{
+    intern("");
+}
+
+StringID StringTable::intern(std::string_view s)
+{
+    auto it = ids.find(s);
+    if (it != ids.end())
+        return it->second;
+
+    StringID id = strings.size();
+    strings.emplace_back(s);
+    ids.insert({strings.back(), id});
+    qstrings.emplace_back();
+    has_qstring.push_back(false);
+    return id;
+}
+
+void StringTable::clear()
+{
+    ids.clear();
+    strings.clear();
+    qstrings.clear();
+    has_qstring.clear();
+    serial = next_serial++;
+    intern("");
+}
+
+const QString & StringTable::qstring(StringID id) const
+{
+    if ( ! has_qstring[id])
+    {
+        qstrings[id] = QString::fromStdString(strings[id]);
+        has_qstring[id] = true;
+    }
+    return qstrings[id];
+}
+
+} // namespace
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "types.hpp"
+
+namespace ganttry
+{
+
+// Every distinct piece of text of a workspace, stored once. Ids stay valid
+// until clear(), so equal text compares by id and repeated
+// names share one allocation; the QString form is built once, on first
+// display. Only used from the GUI thread.
+class StringTable
+{
+    std::deque<std::string> strings; // stable addresses for the views below
+    std::unordered_map<std::string_view,StringID> ids;
+    mutable std::vector<QString> qstrings;
+    mutable std::vector<bool> has_qstring;
+    std::uint64_t serial;
+
+public:
+    StringTable();
+    StringTable(const StringTable &) = delete;
+    StringTable & operator=(const StringTable &) = delete;
+
+    StringID intern(std::string_view s);
+    inline const std::string & get(StringID id) const { return strings[id]; }
+    const QString & qstring(StringID id) const;
+    // drops everything but "", and takes a new serial so cached ids miss
+    void clear();
+
+    inline size_t size() const { return strings.size(); }
+    // tells tables apart, for caches keyed by id
+    inline std::uint64_t get_serial() const { return serial; }
+};
+
+} // namespace
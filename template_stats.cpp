@@ -0,0 +1,203 @@
+
+#include "template_stats.hpp"
+#include "workspace.hpp"
+
+namespace ganttry
+{
+
+void RunningStats::add(double x)
+{
+    count += 1;
+    double delta = x - mean;
+    mean += delta / count;
+    M2 += delta * (x - mean);
+}
+
+void RunningStats::remove(double x)
+{
+    if (count <= 1)
+    {
+        *this = {};
+        return;
+    }
+    double previous_mean = (count * mean - x) / (count - 1);
+    M2 -= (x - mean) * (x - previous_mean);
+    mean = previous_mean;
+    count -= 1;
+}
+
+void RunningStats::merge(const RunningStats & other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+    double total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    M2 += other.M2 + delta * delta * count * other.count / total;
+    count = total;
+}
+
+void TemplateStats::merge(const TemplateStats & other)
+{
+    UDM                   .merge(other.UDM                   );
+    material_cost_per_unit.merge(other.material_cost_per_unit);
+    manpower_cost_per_unit.merge(other.manpower_cost_per_unit);
+}
+
+bool TemplateStatsLearner::observe(const Task_Base & task, Observation & observation)
+{
+    if ( ! task.is_relative() || task.is_recursive() || task.get_template_id() < 0)
+        return false;
+    double done = task.get_units_done_count();
+    if (done <= 0)
+        return false;
+
+    observation = {task.get_template_id(), false, false, false, 0, 0, 0};
+
+    // measured from the first recorded progress, not the scheduled start,
+    // which the learned UDM itself moves
+    nixtime start = task.get_actual_start();
+    double  units = done - task.get_actual_start_units();
+    if (start != 0 && task.get_progress_time() > start && units > 0)
+    {
+        observation.has_UDM = true;
+        observation.UDM = units / ((task.get_progress_time() - start) / 86400.0);
+    }
+    if (task.get_actual_material_cost() > 0)
+    {
+        observation.has_material = true;
+        observation.material = task.get_actual_material_cost() / done;
+    }
+    if (task.get_actual_manpower_cost() > 0)
+    {
+        observation.has_manpower = true;
+        observation.manpower = task.get_actual_manpower_cost() / done;
+    }
+
+    return observation.has_UDM || observation.has_material || observation.has_manpower;
+}
+
+void TemplateStatsLearner::add(const Project & project, const Observation & observation)
+{
+    TemplateStats & stats = per_project[&project][observation.template_id];
+    if (observation.has_UDM     ) stats.UDM                   .add(observation.UDM     );
+    if (observation.has_material) stats.material_cost_per_unit.add(observation.material);
+    if (observation.has_manpower) stats.manpower_cost_per_unit.add(observation.manpower);
+}
+
+void TemplateStatsLearner::remove(const Project & project, const Observation & observation)
+{
+    TemplateStats & stats = per_project[&project][observation.template_id];
+    if (observation.has_UDM     ) stats.UDM                   .remove(observation.UDM     );
+    if (observation.has_material) stats.material_cost_per_unit.remove(observation.material);
+    if (observation.has_manpower) stats.manpower_cost_per_unit.remove(observation.manpower);
+}
+
+void TemplateStatsLearner::scan()
+{
+    clear();
+    for (const auto & project : workspace->get_projects())
+        for (const auto & p : project->tasks)
+        {
+            Observation observation;
+            if ( ! observe(*p.second, observation))
+                continue;
+            add(*project, observation);
+            observations[{project.get(), p.first}] = observation;
+        }
+}
+
+std::set<TemplateID> TemplateStatsLearner::task_changed(const Task_Base & task)
+{
+    std::set<TemplateID> result;
+    const Project & project = task.get_project();
+
+    Observation observation;
+    bool observed = observe(task, observation);
+
+    auto it = observations.find({&project, task.get_id()});
+    if (it != observations.end() && observed && it->second == observation)
+        return result; // an edit that is not progress moves nothing
+    if (it != observations.end())
+    {
+        remove(project, it->second);
+        result.insert(it->second.template_id);
+        observations.erase(it);
+    }
+
+    if (observed)
+    {
+        add(project, observation);
+        observations[{&project, task.get_id()}] = observation;
+        result.insert(observation.template_id);
+    }
+
+    return result;
+}
+
+std::set<TemplateID> TemplateStatsLearner::task_removed(const Project & project, TaskID id)
+{
+    auto it = observations.find({&project, id});
+    if (it == observations.end())
+        return {};
+    TemplateID template_id = it->second.template_id;
+    remove(project, it->second);
+    observations.erase(it);
+    return {template_id};
+}
+
+TemplateStats TemplateStatsLearner::template_stats(TemplateID id) const
+{
+    TemplateStats result;
+    for (const auto & p : per_project)
+    {
+        auto it = p.second.find(id);
+        if (it != p.second.end())
+            result.merge(it->second);
+    }
+    return result;
+}
+
+bool TemplateStatsLearner::apply(TemplateID id)
+{
+    TaskTemplate * templ_ptr = workspace->find_task_template(id);
+    if ( ! templ_ptr)
+        return false;
+    TaskTemplate & templ = *templ_ptr;
+    TemplateStats stats = template_stats(id);
+
+    bool changed = false;
+    auto update = [&](float & average, const RunningStats & running)
+        {
+            if (running.count == 0 || average == (float)running.mean)
+                return;
+            average = running.mean;
+            changed = true;
+        };
+    update(templ.average_UDM                   , stats.UDM                   );
+    update(templ.average_material_cost_per_unit, stats.material_cost_per_unit);
+    update(templ.average_manpower_cost_per_unit, stats.manpower_cost_per_unit);
+
+    if (changed)
+    {
+        workspace->task_template_changed(id);
+        workspace->set_changed(true);
+    }
+    return changed;
+}
+
+std::set<TemplateID> TemplateStatsLearner::apply()
+{
+    std::set<TemplateID> result;
+    for (const TaskTemplate & templ : workspace->get_task_templates())
+        if (apply(templ.id))
+            result.insert(templ.id);
+    return result;
+}
+
+} // namespace
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "types.hpp"
+#include "project.hpp"
+
+namespace ganttry
+{
+
+class Workspace;
+
+// Welford's running mean and variance; observations can be taken back
+// out and two sets of stats merged (Chan et al.).
+struct RunningStats
+{
+    double count = 0;
+    double mean  = 0;
+    double M2    = 0;
+
+    void add   (double x);
+    void remove(double x);
+    void merge (const RunningStats & other);
+    inline double variance() const { return count > 1 ? M2 / (count - 1) : 0; }
+};
+
+struct TemplateStats
+{
+    RunningStats UDM;
+    RunningStats material_cost_per_unit;
+    RunningStats manpower_cost_per_unit;
+
+    void merge(const TemplateStats & other);
+};
+
+// Learns each template's average UDM and costs per unit from the tasks
+// that have units done: UDM from the units done since the first recorded
+// progress over the time until the last one, costs from recorded actual costs
+// over done units. Stats are kept per project and merged per template,
+// so an edited task only moves its own observation.
+class TemplateStatsLearner
+{
+    struct Observation
+    {
+        int   template_id;
+        bool  has_UDM;
+        bool  has_material;
+        bool  has_manpower;
+        double UDM;
+        double material;
+        double manpower;
+
+        inline bool operator==(const Observation & other) const
+        {
+            return std::tie(      template_id,       has_UDM,       has_material,       has_manpower,       UDM,       material,       manpower)
+                == std::tie(other.template_id, other.has_UDM, other.has_material, other.has_manpower, other.UDM, other.material, other.manpower);
+        }
+    };
+
+    Workspace * workspace;
+    std::map<const Project*,std::map<TemplateID,TemplateStats>> per_project;
+    std::map<std::tuple<const Project*,TaskID>,Observation> observations;
+
+    static bool observe(const Task_Base & task, Observation & observation);
+    void add   (const Project & project, const Observation & observation);
+    void remove(const Project & project, const Observation & observation);
+
+public:
+    inline TemplateStatsLearner(Workspace & w)
+        : workspace(&w)
+    {}
+
+    inline void set_workspace(Workspace * w) { workspace = w; clear(); }
+    inline void clear() { per_project.clear(); observations.clear(); }
+
+    // full pass over every project of the workspace
+    void scan();
+    // both return the templates whose stats moved
+    std::set<TemplateID> task_changed(const Task_Base & task);
+    std::set<TemplateID> task_removed(const Project & project, TaskID id);
+
+    TemplateStats template_stats(TemplateID id) const;
+
+    // writes the learned averages into the templates,
+    // returns the ones that actually changed
+    std::set<TemplateID> apply();
+    bool apply(TemplateID id);
+};
+
+} // namespace
@@ -0,0 +1,75 @@
+
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+namespace ganttry
+{
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    thread_count = std::max<size_t>(thread_count, 1);
+    workers.reserve(thread_count);
+    for (size_t i=0 ; i<thread_count ; i++)
+        workers.emplace_back([this,i]() { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_cv.notify_all();
+    for (auto & worker : workers)
+        worker.join();
+}
+
+void ThreadPool::worker_loop(size_t worker)
+{
+    std::uint64_t seen_generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_cv.wait(lock, [&]() { return stopping || generation != seen_generation; });
+            if (stopping)
+                return;
+            seen_generation = generation;
+        }
+
+        for (;;)
+        {
+            size_t begin = next_index.fetch_add(job_chunk);
+            if (begin >= job_count)
+                break;
+            job(begin, std::min(begin + job_chunk, job_count), worker);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy_workers == 0)
+                done_cv.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, size_t chunk, std::function<void(size_t,size_t,size_t)> fn)
+{
+    if (count == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job = std::move(fn);
+    job_count = count;
+    job_chunk = std::max<size_t>(chunk, 1);
+    next_index = 0;
+    busy_workers = workers.size();
+    ++generation;
+    job_cv.notify_all();
+
+    done_cv.wait(lock, [&]() { return busy_workers == 0; });
+    job = nullptr;
+}
+
+} // namespace
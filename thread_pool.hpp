@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ganttry
+{
+
+class ThreadPool
+{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::condition_variable done_cv;
+
+    // current job
+    std::function<void(size_t,size_t,size_t)> job; // begin, end, worker index
+    size_t job_count = 0;
+    size_t job_chunk = 1;
+    std::atomic<size_t> next_index{0};
+    size_t busy_workers = 0;
+    std::uint64_t generation = 0;
+    bool stopping = false;
+
+    void worker_loop(size_t worker);
+
+public:
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    inline size_t size() const { return workers.size(); }
+
+    // Calls fn(begin, end, worker) over chunks of [0,count) on every worker
+    // and returns once all of them are done. Not reentrant.
+    void parallel_for(size_t count, size_t chunk, std::function<void(size_t,size_t,size_t)> fn);
+};
+
+} // namespace
@@ -8,5 +8,7 @@ namespace ganttry
 
 using TaskID     = uint64_t;
 using TemplateID = uint64_t;
+using ResourceID = uint64_t;
+using StringID   = uint32_t; // in the workspace's StringTable, 0 is ""
 
 } // namespace
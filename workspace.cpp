@@ -5,6 +5,169 @@
 namespace ganttry
 {
 
+void Workspace::add_task_template(TaskTemplate t)
+{
+    // ids skipped in a loaded file get blank templates, as a lookup of
+    // them used to make
+    TemplateID id = t.id;
+    while (task_templates.size() <= id)
+    {
+        TemplateID blank = task_templates.size();
+        task_templates.push_back(TaskTemplate{blank, "", "", 0, 0, 0, 0, 0, 0, 0});
+        template_UDMs.push_back(0);
+    }
+    task_templates[id] = std::move(t);
+    task_template_changed(id);
+    changed = true;
+}
+
+void Workspace::task_template_changed(TemplateID id)
+{
+    task_templates.at(id).name_id = strings.intern(task_templates[id].name);
+    template_UDMs.at(id) = task_templates[id].effective_UDM();
+    if (id < template_tasks.size())
+        for (Task_Templated * task : template_tasks[id])
+        {
+            task->invalidate_duration();
+            task->get_project().tasks_changed();
+        }
+}
+
+void Workspace::task_templates_changed(const std::set<TemplateID> & ids)
+{
+    // projects holding tasks of the templates
+    std::vector<Project*> pending;
+    std::unordered_set<Project*> affected;
+    for (TemplateID id : ids)
+    {
+        if (id >= task_templates.size())
+            continue;
+        task_template_changed(id);
+        if (id >= template_tasks.size())
+            continue;
+        for (Task_Templated * task : template_tasks[id])
+            if (affected.insert(&task->get_project()).second)
+                pending.push_back(&task->get_project());
+    }
+
+    // and the projects embedding them, counting the embedded ones each waits for
+    std::unordered_map<Project*,int> embedded_left;
+    while ( ! pending.empty())
+    {
+        Project * project = pending.back();
+        pending.pop_back();
+        auto it = subproject_tasks.find(project);
+        if (it == subproject_tasks.end())
+            continue;
+        for (Task_SubProject * task : it->second)
+        {
+            ++embedded_left[&task->get_project()];
+            if (affected.insert(&task->get_project()).second)
+                pending.push_back(&task->get_project());
+        }
+    }
+
+    // one pass per project, children before the projects embedding them
+    for (Project * project : affected)
+        if (embedded_left[project] == 0)
+            pending.push_back(project);
+    while ( ! pending.empty())
+    {
+        Project * project = pending.back();
+        pending.pop_back();
+        project->recalculate_start_offsets();
+        auto it = subproject_tasks.find(project);
+        if (it == subproject_tasks.end())
+            continue;
+        for (Task_SubProject * task : it->second)
+            if (--embedded_left[&task->get_project()] == 0)
+                pending.push_back(&task->get_project());
+    }
+}
+
+std::vector<std::vector<Project*>> Workspace::project_levels() const
+{
+    // Kahn's algorithm over embeddings, an edge per subproject task, in rounds
+    std::unordered_map<const Project*,int> embedded_left;
+    std::unordered_map<const Project*,std::vector<Project*>> embedders;
+    for (const auto & [child, tasks] : subproject_tasks)
+        for (Task_SubProject * task : tasks)
+        {
+            embedders[child].push_back(&task->get_project());
+            ++embedded_left[&task->get_project()];
+        }
+
+    std::vector<std::vector<Project*>> levels(1);
+    size_t placed = 0;
+    for (const auto & project : projects)
+        if (embedded_left[project.get()] == 0)
+            levels[0].push_back(project.get());
+    while ( ! levels.back().empty())
+    {
+        placed += levels.back().size();
+        std::vector<Project*> next;
+        for (Project * child : levels.back())
+            for (Project * parent : embedders[child])
+                if (--embedded_left[parent] == 0)
+                    next.push_back(parent);
+        levels.push_back(std::move(next));
+    }
+    levels.pop_back();
+
+    // embedding a project from outside the workspace, last and one by one
+    if (placed < projects.size())
+        for (const auto & project : projects)
+            if (embedded_left[project.get()] > 0)
+                levels.push_back({project.get()});
+    return levels;
+}
+
+std::vector<Project*> Workspace::projects_bottom_up() const
+{
+    std::vector<Project*> result;
+    result.reserve(projects.size());
+    for (const std::vector<Project*> & level : project_levels())
+        result.insert(result.end(), level.begin(), level.end());
+    return result;
+}
+
+void Workspace::update_project_durations() const
+{
+    for (Project * project : projects_bottom_up())
+        project->duration_in_seconds();
+}
+
+void Workspace::add_template_task(Task_Templated * task)
+{
+    if (task->get_template_id() < 0)
+        return;
+    TemplateID id = task->get_template_id();
+    if (template_tasks.size() <= id)
+        template_tasks.resize(id + 1);
+    template_tasks[id].insert(task);
+}
+
+void Workspace::remove_template_task(Task_Templated * task)
+{
+    if (task->get_template_id() >= 0 && (TemplateID)task->get_template_id() < template_tasks.size())
+        template_tasks[task->get_template_id()].erase(task);
+}
+
+void Workspace::add_subproject_task(Task_SubProject * task)
+{
+    subproject_tasks[task->get_child()].insert(task);
+}
+
+void Workspace::remove_subproject_task(Task_SubProject * task)
+{
+    auto it = subproject_tasks.find(task->get_child());
+    if (it == subproject_tasks.end())
+        return;
+    it->second.erase(task);
+    if (it->second.empty())
+        subproject_tasks.erase(it);
+}
+
 Project * Workspace::get_project_by_filename(std::string filename)
 {
     for (auto & proj : projects)
@@ -5,21 +5,28 @@
 #include <fstream>
 #include <memory>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "types.hpp"
+#include "string_table.hpp"
 #include "project.hpp"
 
 namespace ganttry
 {
 
 struct Project;
+class Task_Templated;
+class Task_SubProject;
 
 struct TaskTemplate
 {
     uint64_t id;
     std::string name;
     std::string description;
-    std::string units;
+    StringID    units;
     float       default_UDM;
     float       average_UDM;
     float       default_material_cost_per_unit;
@@ -27,8 +34,25 @@ struct TaskTemplate
     float       default_manpower_cost_per_unit;
     float       average_manpower_cost_per_unit;
     bool use_avg = true;
+    int         resource_id     = -1; // crew doing the work, -1 for none
+    float       resource_demand =  1; // share of the crew's capacity used while working
+    StringID    name_id         =  0; // name in the workspace's string table, see task_template_changed
 
     inline void set_id(TaskID v) { id = v; }
+
+    // averages win when asked for and known
+    inline float effective_UDM                   () const { return (use_avg && average_UDM                    != 0) ? average_UDM                    : default_UDM                   ; }
+    inline float effective_material_cost_per_unit() const { return (use_avg && average_material_cost_per_unit != 0) ? average_material_cost_per_unit : default_material_cost_per_unit; }
+    inline float effective_manpower_cost_per_unit() const { return (use_avg && average_manpower_cost_per_unit != 0) ? average_manpower_cost_per_unit : default_manpower_cost_per_unit; }
+};
+
+struct Resource
+{
+    uint64_t id;
+    std::string name;
+    float       capacity; // how much demand can run at the same time
+
+    inline void set_id(ResourceID v) { id = v; }
 };
 
 class Workspace
@@ -37,18 +61,32 @@ class Workspace
     std::string filename;
 
     std::string name = "Default workspace";
-    std::map<uint64_t,TaskTemplate> task_templates;
+    StringTable strings; // task names and descriptions, template units
+    // by id, ids are handed out densely; template_UDMs holds each one's
+    // effective_UDM() so durations need no lookup, see task_template_changed
+    std::vector<TaskTemplate> task_templates;
+    std::vector<float> template_UDMs;
+    // the tasks made from each template, by id, to drop their durations
+    std::vector<std::unordered_set<Task_Templated*>> template_tasks;
+    // the subproject tasks embedding each project
+    std::unordered_map<const Project*,std::unordered_set<Task_SubProject*>> subproject_tasks;
+    // last Project::schedule_revision handed out; declared before projects
+    // for their tasks to take one when destroyed
+    std::uint64_t schedule_revisions = 0;
+    std::map<uint64_t,Resource> resources;
     std::vector<std::unique_ptr<Project>> projects;
     size_t current_project_idx = 0;
     uint64_t next_task_template_id = 0;
+    uint64_t next_resource_id = 0;
 
 public:
     inline Workspace() {
-        task_templates.insert({0, {0, "One per month" , "", "Units", 1.0/21 , 0, 0, 0.0, 2100.0       , 0.0, false}});
-        task_templates.insert({1, {0, "One per week"  , "", "Units", 1.0/ 5 , 0, 0, 0.0,  500.0       , 0.0, false}});
-        task_templates.insert({2, {0, "One per day"   , "", "Units", 1      , 0, 0, 0.0,  100.0/1     , 0.0, false}});
-        task_templates.insert({3, {0, "One per hour"  , "", "Units", 8      , 0, 0, 0.0,  100.0/8     , 0.0, false}});
-        task_templates.insert({4, {0, "One per minute", "", "Units", 8*60   , 0, 0, 0.0,  100.0/(8*60), 0.0, false}});
+        StringID units = strings.intern("Units");
+        add_task_template({0, "One per month" , "", units, 1.0/21 , 0, 0, 0.0, 2100.0       , 0.0, false});
+        add_task_template({1, "One per week"  , "", units, 1.0/ 5 , 0, 0, 0.0,  500.0       , 0.0, false});
+        add_task_template({2, "One per day"   , "", units, 1      , 0, 0, 0.0,  100.0/1     , 0.0, false});
+        add_task_template({3, "One per hour"  , "", units, 8      , 0, 0, 0.0,  100.0/8     , 0.0, false});
+        add_task_template({4, "One per minute", "", units, 8*60   , 0, 0, 0.0,  100.0/(8*60), 0.0, false});
         add_new_project();
     }
     inline TaskTemplate & add_task_template( std::string name
@@ -63,14 +101,32 @@ public:
                                            , bool use_avg
                                            )
     {
-        typename decltype(task_templates)::iterator it;
+        TemplateID id = std::max<TemplateID>(next_task_template_id, task_templates.size());
+        add_task_template({id, name, desc, strings.intern(unit), default_UDM, average_UDM, default_material_cost_per_unit, average_material_cost_per_unit, default_manpower_cost_per_unit, average_manpower_cost_per_unit, use_avg});
+        next_task_template_id = id + 1;
+        return task_templates[id];
+    }
+
+    inline Resource & add_resource(std::string name, float capacity)
+    {
+        typename decltype(resources)::iterator it;
         bool b;
         do {
-            std::tie(it,b) = task_templates.insert({next_task_template_id, {next_task_template_id, name, desc, unit, default_UDM, average_UDM, default_material_cost_per_unit, average_material_cost_per_unit, default_manpower_cost_per_unit, average_manpower_cost_per_unit, use_avg}});
-            ++next_task_template_id;
+            std::tie(it,b) = resources.insert({next_resource_id, {next_resource_id, name, capacity}});
+            ++next_resource_id;
         } while (!b);
+        changed = true;
         return it->second;
     }
+    inline Resource * find_resource(int id)
+    {
+        if (id < 0)
+            return nullptr;
+        auto it = resources.find(id);
+        if (it == resources.end())
+            return nullptr;
+        return &it->second;
+    }
 
     inline Project & add_new_project()
     {
@@ -89,28 +145,77 @@ public:
     inline void set_current_project_idx(size_t idx) { current_project_idx = idx; }
     inline uint64_t get_next_task_template_id() const { return next_task_template_id; }
     inline void set_next_task_template_id(uint64_t n) { next_task_template_id = n; }
-
-    inline TaskTemplate & get_task_template(TemplateID id) { return task_templates[id]; }
+    inline uint64_t get_next_resource_id() const { return next_resource_id; }
+    inline void set_next_resource_id(uint64_t n) { next_resource_id = n; }
+
+    // the template must exist, find_task_template tells
+    inline TaskTemplate & get_task_template(TemplateID id) { return task_templates.at(id); }
+    inline TaskTemplate * find_task_template(TemplateID id) { return id < task_templates.size() ? &task_templates[id] : nullptr; }
+    inline const TaskTemplate * find_task_template(TemplateID id) const { return id < task_templates.size() ? &task_templates[id] : nullptr; }
+    // 0 when unknown
+    inline float get_task_template_UDM(TemplateID id) const { return id < template_UDMs.size() ? template_UDMs[id] : 0; }
+    // after editing a template in place, drops its tasks' durations at once
+    void task_template_changed(TemplateID id);
+    // after a batch of template edits, reschedules once each project with
+    // tasks made from them and each project embedding those, children first
+    void task_templates_changed(const std::set<TemplateID> & ids);
+
+    // Projects by embedding level, from the subproject index: level 0
+    // embeds nothing, each other one only projects of the levels before,
+    // so the projects of a level can be scheduled independently.
+    std::vector<std::vector<Project*>> project_levels() const;
+    // the levels one after the other
+    std::vector<Project*> projects_bottom_up() const;
+    // each project's duration computed once, children first, then shared
+    // through Project::duration_in_seconds until a task changes
+    void update_project_durations() const;
+
+    void add_template_task     (Task_Templated  * task);
+    void remove_template_task  (Task_Templated  * task);
+    void add_subproject_task   (Task_SubProject * task);
+    void remove_subproject_task(Task_SubProject * task);
+    // the subproject tasks embedding a project, null when none
+    inline const std::unordered_set<Task_SubProject*> * find_subproject_tasks(const Project * project) const
+    {
+        auto it = subproject_tasks.find(project);
+        return it != subproject_tasks.end() ? &it->second : nullptr;
+    }
+    // the tasks using a template, null when none
+    inline const std::unordered_set<Task_Templated*> * find_template_tasks(TemplateID id) const
+    {
+        return id < template_tasks.size() ? &template_tasks[id] : nullptr;
+    }
+    inline std::uint64_t next_schedule_revision() { return ++schedule_revisions; }
 
     inline void reset()
     {
         name = "";
+        projects.clear(); // first, its tasks still point into the indexes below
         task_templates.clear();
-        projects.clear();
+        template_UDMs.clear();
+        template_tasks.clear();
+        subproject_tasks.clear();
+        resources.clear();
+        strings.clear();
         changed = false;
     }
 
     Project * get_project_by_filename(std::string filename);
 
+    inline       StringTable & get_strings()       { return strings; }
+    inline const StringTable & get_strings() const { return strings; }
     inline const std::string & get_name    () const { return name    ; }
     inline const std::string & get_filename() const { return filename; }
     inline const auto & get_task_templates() const { return task_templates; }
     inline       auto & get_task_templates()       { return task_templates; }
+    inline const auto & get_resources     () const { return resources; }
+    inline       auto & get_resources     ()       { return resources; }
     inline const auto & get_projects      () const { return projects; }
     inline       bool   get_changed       () const { return changed; }
     inline void set_filename     (std::string  f) { filename = f            ; changed = true; }
     inline void set_name         (std::string  n) { name     = n            ; changed = true; }
-    inline void add_task_template(TaskTemplate t) { task_templates[t.id] = std::move(t); changed = true; }
+    void add_task_template(TaskTemplate t);
+    inline void add_resource     (Resource     r) { resources[r.id] = std::move(r); changed = true; }
     inline void set_changed      (bool         b) { changed  = b; }
 
 };